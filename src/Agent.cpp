@@ -2,63 +2,20 @@
 #include "StreamRenderer.h"
 #include "WebSearcher.h"
 #include "Helpers.h"
+#include "Router.h"
+#include "SubAgent.h"
+#include "TextUtil.h"
 #include <iostream>
 #include <fstream>
-#include <regex>
 #include <thread>
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <optional>
 #include <sys/utsname.h>
 
 namespace lira {
 
-    // --- Helper: Strip Reasoning ---
-    static std::string strip_reasoning(const std::string& input) {
-        std::regex think_regex(R"(<think>[\s\S]*?</think>)");
-        return std::regex_replace(input, think_regex, "");
-    }
-
-    // --- Helper: Force Valid UTF-8 ---
-    // Replaces invalid bytes with '?' to prevent JSON crashes
-    static std::string sanitize_utf8(const std::string& str) {
-        std::string result;
-        result.reserve(str.size());
-
-        for (size_t i = 0; i < str.size(); ++i) {
-            unsigned char c = static_cast<unsigned char>(str[i]);
-            if (c < 0x80) {
-                // ASCII (0xxxxxxx)
-                result += c;
-            } else {
-                // Check Multibyte
-                int len = 0;
-                if ((c & 0xE0) == 0xC0) len = 2; // 110xxxxx
-                else if ((c & 0xF0) == 0xE0) len = 3; // 1110xxxx
-                else if ((c & 0xF8) == 0xF0) len = 4; // 11110xxx
-
-                bool valid = (len > 0) && (i + len <= str.size());
-                if (valid) {
-                    for (int j = 1; j < len; ++j) {
-                        if ((static_cast<unsigned char>(str[i + j]) & 0xC0) != 0x80) {
-                            valid = false;
-                            break;
-                        }
-                    }
-                }
-
-                if (valid) {
-                    for (int j = 0; j < len; ++j) result += str[i + j];
-                    i += (len - 1);
-                } else {
-                    // Invalid byte found, replace with placeholder
-                    result += '?';
-                }
-            }
-        }
-        return result;
-    }
-
     // --- Helper: Deep System Inspection ---
     static std::string get_system_details() {
         std::string info = "";
@@ -104,7 +61,7 @@ namespace lira {
         return info;
     }
 
-    Agent::Agent(const std::string& session_name) : current_session_name(session_name) {
+    Agent::Agent(const std::string& session_name) : nexus(Nexus::shared()), current_session_name(session_name) {
         const char* env_p = std::getenv("OPENROUTER_API_KEY");
         if(!env_p) { std::cerr << "Need OPENROUTER_API_KEY env var."; exit(1); }
         api_key = env_p;
@@ -116,44 +73,224 @@ namespace lira {
         std::cout << "\033[1;30m[Session: " << session_name << " loaded]\033[0m" << std::endl;
     }
 
+    // A summary still in flight is cancelled; ~Compaction joins its thread
+    Agent::~Agent() = default;
+
     void Agent::load_history() {
         if (fs::exists(history_path)) {
             std::ifstream f(history_path);
             try { history = json::parse(f); } catch(...) { history = json::array(); }
         } else { history = json::array(); }
+
+        std::lock_guard lock(display_mtx);
+        display.clear();
+        for (const auto& item : history) {
+            // Handle potential nulls or missing fields gracefully
+            if (!item.contains("role") || !item.contains("content") || item["role"] == "system") continue;
+            try {
+                display.push_back({item["role"].get<std::string>(), item["content"].get<std::string>()});
+            } catch (...) {}
+        }
+        display_ver.fetch_add(1, std::memory_order_release);
+    }
+
+    // --- History Compaction ---
+    // Messages sent with each request; older ones reach the model only
+    // through the running summary
+    constexpr size_t PROMPT_MESSAGES = 20;
+    // Messages kept in the session file, summarized ones included
+    constexpr size_t FILE_MESSAGES = 200;
+    // The newest messages are never summarized
+    constexpr size_t KEEP_RECENT = 6;
+    // Per-message cap in the summary request; old command output is mostly noise
+    constexpr size_t SUMMARY_INPUT_CHARS = 2000;
+
+    constexpr std::string_view SUMMARY_PROMPT =
+        "You compress the earlier part of a conversation between a user and Lira, a Linux/C++ assistant "
+        "that runs shell commands, searches the web and writes files. Write a concise summary (at most 300 words) "
+        "for Lira to read instead of the original messages. Keep: the user's goals and preferences, decisions made, "
+        "file paths, commands run and what they showed, and anything still unresolved. Drop raw command output and pleasantries. "
+        "Reply with the summary only.";
+
+    // A finished summary replaces history [first, first + count) as seen at launch
+    struct Agent::Compaction {
+        size_t first = 0;
+        size_t count = 0;
+        size_t trimmed = 0;            // Agent::trimmed at launch
+        std::atomic<bool> done{false};
+        std::atomic<bool> cancel{false};
+        std::string summary;           // empty if the request failed
+        std::thread worker;
+
+        ~Compaction() {
+            cancel.store(true, std::memory_order_relaxed);
+            if (worker.joinable()) worker.join();
+        }
+    };
+
+    // Longest pause, in turns, after repeated summary failures
+    constexpr size_t MAX_COMPACT_WAIT = 32;
+
+    static bool is_summary(const json& m) { return m.is_object() && m.value("summary", false); }
+    static bool is_summarized(const json& m) { return m.is_object() && m.value("summarized", false); }
+
+    static size_t content_size(const json& m) {
+        const auto it = m.find("content");
+        return it != m.end() && it->is_string() ? it->get_ref<const std::string&>().size() : 0;
+    }
+
+    // Starts summarizing old history on a background thread once the messages
+    // still sent in full pass the size threshold. Never waits: the result is
+    // picked up by a later apply_compaction().
+    void Agent::maybe_compact() {
+        const size_t threshold = get_compact_chars();
+        if (!threshold || compaction || !more_turns) return;
+        if (compact_wait) { compact_wait--; return; }
+
+        std::vector<size_t> live;
+        size_t chars = 0;
+        for (size_t i = 0; i < history.size(); ++i) {
+            if (is_summarized(history[i])) continue;
+            live.push_back(i);
+            chars += content_size(history[i]);
+        }
+        if (chars < threshold || live.size() <= KEEP_RECENT) return;
+
+        // Everything live before the newest KEEP_RECENT, the previous summary included
+        const size_t first = live.front();
+        const size_t end = live[live.size() - KEEP_RECENT];
+        std::string transcript;
+        for (size_t i = first; i < end; ++i) {
+            const json& m = history[i];
+            if (is_summarized(m) || !m.contains("content") || !m["content"].is_string()) continue;
+            std::string content = m["content"].get<std::string>();
+            if (content.size() > SUMMARY_INPUT_CHARS) content = content.substr(0, SUMMARY_INPUT_CHARS) + "\n...(truncated)";
+            if (is_summary(m)) transcript += "[Earlier summary]\n" + content + "\n\n";
+            else transcript += "[" + m.value("role", "user") + "]\n" + content + "\n\n";
+        }
+
+        auto job = std::make_shared<Compaction>();
+        job->first = first;
+        job->count = end - first;
+        job->trimmed = trimmed;
+        compaction = job;
+
+        // The thread only reaches the job through this pointer; the job joins it
+        job->worker = std::thread([job = job.get(), key = api_key, transcript = sanitize_utf8(transcript)] {
+            trace::set_thread_name("compaction");
+            trace::Span span("agent", "summarize_history");
+            const json pl = {
+                {"model", get_summary_model()},
+                {"messages", {
+                    {{"role", "system"}, {"content", SUMMARY_PROMPT}},
+                    {{"role", "user"}, {"content", transcript}},
+                }},
+                {"stream", true},
+                {"max_tokens", 1024}
+            };
+            // Collected, not shown
+            StreamRenderer renderer([](TokenType, std::string_view) {});
+            renderer.apply_writes = false;
+            StreamStats stats;
+            http_post_stream(get_api_url(), pl, key, renderer, &stats, &job->cancel);
+            if (stats.completed && stats.http_status < 400) job->summary = strip_reasoning(renderer.full_response);
+            job->done.store(true, std::memory_order_release);
+        });
+    }
+
+    // Folds a finished summary into the history: the covered messages are
+    // flagged (kept for display and in the session file) and the summary goes
+    // in after them as a system message
+    void Agent::apply_compaction() {
+        if (!compaction || !compaction->done.load(std::memory_order_acquire)) return;
+        const auto job = std::move(compaction);
+        if (job->summary.empty()) {
+            // Back off: 1, 2, 4, ... turns before the next attempt
+            compact_wait = std::min(MAX_COMPACT_WAIT, size_t{1} << std::min<size_t>(compact_failures, 5));
+            compact_failures++;
+            return;
+        }
+        compact_failures = 0;
+
+        const size_t shift = trimmed - job->trimmed;
+        const size_t first = job->first > shift ? job->first - shift : 0;
+        const size_t end = job->first + job->count > shift ? job->first + job->count - shift : 0;
+        for (size_t i = first; i < end && i < history.size(); ++i) history[i]["summarized"] = true;
+        history.insert(history.begin() + static_cast<std::ptrdiff_t>(std::min(end, history.size())), json{
+            {"role", "system"},
+            {"summary", true},
+            {"content", "Summary of the earlier conversation:\n" + job->summary}
+        });
+        save_history();
+        report(ANSI_GRAY, std::format("[Summarized {} earlier messages]", job->count));
     }
 
     void Agent::save_history() {
-        if (history.size() > 20) {
+        trace::Span span("agent", "save_history");
+        if (history.size() > FILE_MESSAGES) {
+            const size_t drop = history.size() - FILE_MESSAGES;
             json new_h = json::array();
-            for(size_t i=history.size()-20; i<history.size(); ++i) new_h.push_back(history[i]);
+            for(size_t i=drop; i<history.size(); ++i) new_h.push_back(history[i]);
             history = new_h;
+            trimmed += drop;
         }
         std::ofstream o(history_path);
         // Use replace handler just in case something slipped through
         o << history.dump(4, ' ', true, json::error_handler_t::replace);
     }
 
-    std::vector<ChatMessage> Agent::get_display_history() {
-        std::vector<ChatMessage> display;
-        for (const auto& item : history) {
-            if (item["role"] == "system") continue;
-            // Handle potential nulls or missing fields gracefully
-            if (!item.contains("role") || !item.contains("content")) continue;
-
-            display.push_back({
-                item["role"].get<std::string>(),
-                item["content"].get<std::string>()
-            });
+    void Agent::add_message(const std::string& role, const std::string& content) {
+        history.push_back({{"role", role}, {"content", content}});
+        if (role != "system") {
+            std::lock_guard lock(display_mtx);
+            display.push_back({role, content});
+            display_ver.fetch_add(1, std::memory_order_release);
         }
-        return display;
     }
 
+    void Agent::display_since(size_t from, std::vector<const ChatMessage*>& out) const {
+        std::lock_guard lock(display_mtx);
+        for (size_t i = from; i < display.size(); ++i) out.push_back(&display[i]);
+    }
+
+    // Tool status line: colored on the terminal, a ToolOutput token for front-ends
+    void Agent::report(const std::string& ansi, const std::string& text) {
+        if (on_token) on_token(TokenType::ToolOutput, text + "\n");
+        else std::cout << ansi << text << ANSI_RESET << std::endl;
+    }
+
+    static bool ask_on_stdin(const std::string& cmd) {
+        std::cout << "\033[1;33m[EXEC] \033[1;37m" << cmd << "\033[0m\nAllow? [y/N]: ";
+        char c; std::cin >> c;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        return c == 'y' || c == 'Y';
+    }
+
+    // Runs one tool execution and records how long it took
+    template<class F>
+    static auto timed_tool(const Metrics::Model& metrics, F&& run) {
+        const auto start = std::chrono::steady_clock::now();
+        auto result = run();
+        metrics.add(Metrics::TOOL_CALLS);
+        metrics.record(Metrics::TOOL_US, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        return result;
+    }
+
+    // <spawn> tags run per reply; further ones are dropped
+    constexpr size_t MAX_SPAWN_TASKS = 16;
+
     void Agent::process(std::string user_input) {
         // Sanitize user input immediately
         user_input = sanitize_utf8(user_input);
+        last_requests.clear();
+        apply_compaction();
+        trace::Span turn_span("agent", "turn");
+        turn_span.arg("session", current_session_name);
+        const auto turn_start = std::chrono::steady_clock::now();
+        const auto metrics = Metrics::shared()->model(get_model());
+        trace::Span prompt_span("agent", "build_prompt");
 
-        std::string relevant_memories = nexus.retrieve_relevant(user_input);
+        std::string relevant_memories = nexus->retrieve_relevant(user_input);
 
         // Time & Date
         auto now = std::chrono::system_clock::now();
@@ -183,8 +320,10 @@ namespace lira {
             "Tools (Hidden tags):\n"
             "- <cmd>command</cmd> : Execute shell (bash/zsh).\n"
             "- <write file=\"path\">content</write> : Write file.\n"
-            "- <search>query</search> : Google Search.\n"
+            "- <search>query</search> : Google Search. Several <search> tags in one reply run in parallel.\n"
+            "- <fetch>url</fetch> : Read the main text of a web page. Several <fetch> tags run in parallel.\n"
             "- <remember>fact</remember> : Save to Nexus.\n"
+            "{}"
             "\n"
             "MANDATORY PROTOCOLS:\n"
             "1. **JOURNALING**: If the user tells you a preference, project detail, or name, you MUST use <remember> immediately to save it.\n"
@@ -195,90 +334,149 @@ namespace lira {
             date_ss.str(),
             sys_info,
             cwd_safe,
-            relevant_memories
+            relevant_memories,
+            get_spawn_requests() > 0
+                ? "- <spawn>task</spawn> : Delegate an independent subtask to a parallel sub-agent (shell, search, fetch). "
+                  "Several <spawn> tags run at once; their reports come back together.\n"
+                : ""
         );
 
-        json msgs = json::array();
+        // Request payloads and stream parse trees for this turn; freed in one go at the end
+        std::optional<TurnArena> arena;
+        if (get_turn_arena_enabled()) arena.emplace();
+
+        turn_json msgs = turn_json::array();
         msgs.push_back({{"role", "system"}, {"content", sys_prompt}});
-        for(auto& m : history) msgs.push_back(m);
+        // The running summary, then the newest messages it doesn't cover
+        std::vector<const json*> live;
+        for (const auto& m : history) {
+            if (!is_summarized(m) && m.contains("role") && m.contains("content")) live.push_back(&m);
+        }
+        const size_t skip = live.size() > PROMPT_MESSAGES ? live.size() - PROMPT_MESSAGES : 0;
+        for (size_t i = 0; i < live.size(); ++i) {
+            if (i < skip && !is_summary(*live[i])) continue;
+            msgs.push_back({{"role", turn_json((*live[i])["role"])}, {"content", turn_json((*live[i])["content"])}});
+        }
         msgs.push_back({{"role", "user"}, {"content", user_input}});
+        prompt_span.end();
 
         bool task_done = false;
         int turns = 0;
+        const auto router = ModelRouter::shared();
+        std::shared_ptr<std::atomic<long>> spawn_budget;  // shared by every <spawn> of this turn
 
         while(!task_done && turns < 6) {
-            std::cout << ANSI_MAGENTA << "Lira > " << ANSI_RESET << std::flush;
+            if (!on_token) std::cout << ANSI_MAGENTA << "Lira > " << ANSI_RESET << std::flush;
 
-            json pl = {
-                {"model", get_model()},
-                {"messages", msgs},
+            Route route = router->route(ModelRouter::features(msgs, turns > 0));
+
+            // The conversation moves into the payload and back instead of being copied
+            turn_json pl = {
+                {"model", route.model},
+                {"messages", std::move(msgs)},
                 {"stream", true},
                 {"max_tokens", 4096}
             };
 
-            StreamRenderer renderer;
-            extern void http_post_stream(const std::string&, const json&, const std::string&, StreamRenderer&);
-            http_post_stream("https://openrouter.ai/api/v1/chat/completions", pl, api_key, renderer);
+            std::optional<StreamRenderer> renderer;
+            for (;;) {
+                renderer.emplace(on_token);
+                http_post_stream(get_api_url(), pl, api_key, *renderer, &last_requests.emplace_back());
+                router->observe(route.model, last_requests.back());
+                // A fast model that fails gets one retry on the strong one
+                if (!renderer->full_response.empty() || route.model == router->strong_model()) break;
+                route = router->fallback(route);
+                pl["model"] = route.model;
+            }
+            msgs = std::move(pl["messages"]);
 
-            std::string full_content = renderer.full_response;
+            std::string full_content = renderer->full_response;
             if (full_content.empty()) break;
+            trace::Span tools_span("agent", "handle_reply");
 
             std::string history_content = strip_reasoning(full_content);
             if (history_content.empty()) history_content = "...";
 
             msgs.push_back({{"role", "assistant"}, {"content", history_content}});
-            history.push_back({{"role", "user"}, {"content", user_input}});
-            history.push_back({{"role", "assistant"}, {"content", history_content}});
+            add_message("user", user_input);
+            add_message("assistant", history_content);
             save_history();
 
             bool requires_reprompt = false;
 
             // Search
-            auto search_start = full_content.find("<search>");
-            auto search_end = full_content.find("</search>");
-            if (search_start != std::string::npos && search_end != std::string::npos) {
-                std::string query = full_content.substr(search_start + 8, search_end - (search_start + 8));
-                std::string result = WebSearcher::perform_search(query);
+            const auto queries = extract_tags(full_content, "<search>", "</search>");
+            if (!queries.empty()) {
+                std::string label;
+                for (const auto& q : queries) label += (label.empty() ? "" : " | ") + q;
+                report(ANSI_BLUE, "[Searching Google: " + label + "...]");
+                std::string result = WebSearcher::format(timed_tool(metrics, [&] { return WebSearcher::search(queries, SearchOptions::from_env()); }));
                 std::string output_block = "Search Result:\n" + sanitize_utf8(result);
                 msgs.push_back({{"role", "user"}, {"content", output_block}});
                 requires_reprompt = true;
                 user_input = output_block;
             }
 
-            // Write
-            auto write_start = full_content.find("<write file=\"");
-            if (write_start != std::string::npos) {
-                size_t file_start = write_start + 13;
-                size_t file_end = full_content.find('\"', file_start);
-                size_t content_start = full_content.find('>', file_end) + 1;
-                size_t content_end = full_content.find("</write>", content_start);
-
-                if (file_end != std::string::npos && content_start != std::string::npos && content_end != std::string::npos) {
-                    std::string fname = full_content.substr(file_start, file_end - file_start);
-                    std::string fcontent = full_content.substr(content_start, content_end - content_start);
-
-                    if (fcontent.find("```") != std::string::npos) {
-                         size_t code_start = fcontent.find("```");
-                         size_t newline = fcontent.find('\n', code_start);
-                         if (newline != std::string::npos) fcontent = fcontent.substr(newline + 1);
-                         size_t code_end = fcontent.rfind("```");
-                         if (code_end != std::string::npos) fcontent = fcontent.substr(0, code_end);
-                    }
-                    const char* ws = " \t\n\r\f\v";
-                    size_t start = fcontent.find_first_not_of(ws);
-                    if (start != std::string::npos) fcontent.erase(0, start);
-                    size_t end = fcontent.find_last_not_of(ws);
-                    if (end != std::string::npos) fcontent.erase(end + 1);
-
-                    std::ofstream of(fname);
-                    of << fcontent;
-                    of.close();
-
-                    std::cout << ANSI_GREEN << "[WRITE] Saved to " << fname << ANSI_RESET << std::endl;
-                    msgs.push_back({{"role", "user"}, {"content", "File " + fname + " written successfully."}});
-                    requires_reprompt = true;
-                    user_input = "File Written";
+            // Fetch
+            auto urls = extract_tags(full_content, "<fetch>", "</fetch>");
+            for (auto& url : urls) {
+                url.erase(0, url.find_first_not_of(" \t\n"));
+                url.erase(url.find_last_not_of(" \t\n") + 1);
+            }
+            if (!urls.empty()) {
+                std::string label;
+                for (const auto& u : urls) label += (label.empty() ? "" : " | ") + u;
+                report(ANSI_BLUE, "[Fetching: " + label + "...]");
+                const auto pages = timed_tool(metrics, [&] { return WebSearcher::fetch(urls, get_fetch_budget(), SearchOptions::from_env()); });
+                std::string output_block = "Fetch Result:\n" + sanitize_utf8(WebSearcher::format(pages));
+                msgs.push_back({{"role", "user"}, {"content", output_block}});
+                requires_reprompt = true;
+                user_input = output_block;
+            }
+
+            // Spawn: independent subtasks on parallel child agents
+            auto tasks = extract_tags(full_content, "<spawn>", "</spawn>");
+            if (!tasks.empty()) {
+                std::string output_block;
+                if (!spawn_budget) spawn_budget = std::make_shared<std::atomic<long>>(get_spawn_requests());
+                if (spawn_budget->load() <= 0) {
+                    report(ANSI_GRAY, "[Spawn skipped: sub-agent request budget used up]");
+                    output_block = "Sub-agent Results:\nNo sub-agents were started: the request budget is used up. Do the tasks yourself.";
+                } else {
+                    if (tasks.size() > MAX_SPAWN_TASKS) tasks.resize(MAX_SPAWN_TASKS);
+                    report(ANSI_BLUE, std::format("[Spawning {} sub-agents...]", tasks.size()));
+                    SubAgent::Options opt;
+                    opt.api_key = api_key;
+                    opt.nexus = nexus;
+                    opt.request_budget = spawn_budget;
+                    opt.approve_command = [this](const std::string& cmd) {
+                        trace::Span approve_span("agent", "approve_command");
+                        return approve_command ? approve_command(cmd) : ask_on_stdin(cmd);
+                    };
+                    const auto results = timed_tool(metrics, [&] { return SubAgent::run_all(tasks, std::move(opt)); });
+                    size_t finished = 0, requests = 0;
+                    for (const auto& r : results) { finished += r.ok; requests += r.requests; }
+                    report(ANSI_BLUE, std::format("[Sub-agents done: {}/{} finished, {} requests]", finished, results.size(), requests));
+                    output_block = sanitize_utf8(SubAgent::format(results));
                 }
+                msgs.push_back({{"role", "user"}, {"content", output_block}});
+                requires_reprompt = true;
+                user_input = output_block;
+            }
+
+            // Write (already streamed to disk by the renderer)
+            for (const auto& w : renderer->writes) {
+                std::string status;
+                if (w.ok) {
+                    report(ANSI_GREEN, "[WRITE] Saved to " + w.path);
+                    status = "File " + w.path + " written successfully.";
+                } else {
+                    report("\033[1;31m", "[WRITE] Failed " + w.path + ": " + w.error);
+                    status = "Failed to write " + w.path + ": " + w.error;
+                }
+                msgs.push_back({{"role", "user"}, {"content", status}});
+                requires_reprompt = true;
+                user_input = w.ok ? "File Written" : "Write Failed";
             }
 
             // Nexus
@@ -286,7 +484,7 @@ namespace lira {
             auto mem_end = full_content.find("</remember>");
             if (mem_start != std::string::npos && mem_end != std::string::npos) {
                 std::string fact = full_content.substr(mem_start + 10, mem_end - (mem_start + 10));
-                nexus.add_memory(fact);
+                nexus->add_memory(fact);
             }
 
             // Command
@@ -300,7 +498,7 @@ namespace lira {
                      std::erase(target_dir, '\"');
                      try {
                          fs::current_path(target_dir);
-                         std::cout << ANSI_BLUE << "[CWD] Changed to " << fs::current_path().string() << ANSI_RESET << std::endl;
+                         report(ANSI_BLUE, "[CWD] Changed to " + fs::current_path().string());
                          msgs.push_back({{"role", "user"}, {"content", "Directory changed to " + fs::current_path().string()}});
                          requires_reprompt = true;
                          user_input = "Directory Changed";
@@ -310,17 +508,19 @@ namespace lira {
                          user_input = "CD Failed";
                      }
                 } else {
-                    std::cout << "\033[1;33m[EXEC] \033[1;37m" << cmd << "\033[0m\nAllow? [y/N]: ";
-                    char c; std::cin >> c;
-                    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-                    if(c == 'y' || c == 'Y') {
-                        std::string out = exec_command(cmd.c_str());
+                    bool allowed;
+                    {
+                        // Time spent waiting on the user, not on lira
+                        trace::Span approve_span("agent", "approve_command");
+                        allowed = approve_command ? approve_command(cmd) : ask_on_stdin(cmd);
+                    }
+                    if (allowed) {
+                        std::string out = timed_tool(metrics, [&] { return exec_command(cmd.c_str()); });
                         // Sanitize output!
                         std::string clean_out = sanitize_utf8(out);
 
                         std::string out_prev = clean_out.length() > 500 ? clean_out.substr(0,500) + "\n...(truncated)" : clean_out;
-                        std::cout << "\033[0;32m" << out_prev << "\033[0m\n";
+                        report("\033[0;32m", out_prev);
 
                         std::string output_block = "Output:\n" + clean_out;
                         msgs.push_back({{"role", "user"}, {"content", output_block}});
@@ -337,6 +537,14 @@ namespace lira {
             if(!requires_reprompt) task_done = true;
             else turns++;
         }
+
+        last_arena = arena ? arena->stats() : TurnArena::Stats{};
+        metrics.add(Metrics::TURNS);
+        metrics.record(Metrics::TURN_US, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - turn_start).count());
+        turn_span.end();
+        apply_compaction();
+        maybe_compact();
+        trace::flush();
     }
 
 } // namespace
\ No newline at end of file
@@ -3,10 +3,19 @@
 //
 
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
 #include <nlohmann/json_fwd.hpp>
+#include "Arena.h"
 #include "Nexus.h"
+#include "StreamRenderer.h"
+#include "StreamStats.h"
 
 namespace lira
 {
@@ -21,19 +30,61 @@ namespace lira
         // json history; // Changed to public access via getter or friend, see below.
         // Actually, let's keep it private but provide a converter.
         std::string history_path;
-        Nexus nexus;
+        std::shared_ptr<Nexus> nexus; // process-wide, see Nexus::shared()
+
+        // Display view of `history`: append-only, so references stay valid and
+        // the GUI only rebuilds when the version moves
+        std::deque<ChatMessage> display;
+        std::atomic<uint64_t> display_ver{0};
+        mutable std::mutex display_mtx;   // process() may run on a worker thread
+
+        void report(const std::string& ansi, const std::string& text);
 
         void load_history();
         void save_history();
 
+        // Background summary of old history; at most one in flight, joined
+        // (and cancelled) by the destructor
+        struct Compaction;
+        std::shared_ptr<Compaction> compaction;
+        size_t trimmed = 0;  // messages save_history() has dropped from the front so far
+        size_t compact_failures = 0;  // in a row; each doubles the turns skipped before retrying
+        size_t compact_wait = 0;      // turns left before the next attempt
+        void maybe_compact();
+        void apply_compaction();
+
     public:
         nlohmann::json history; // Made public for direct GUI access (simplifies binding)
         std::string current_session_name;
 
+        // Front-end hooks; when unset, process() renders to the terminal and
+        // asks for command approval on stdin
+        RenderCallback on_token;
+        std::function<bool(const std::string& cmd)> approve_command;
+
+        // Timing of each model request made by the last process() call; a
+        // turn with tool calls has one per round trip
+        std::vector<StreamStats> last_requests;
+        // Turn arena use of the last process() call (zero with LIRA_TURN_ARENA=0)
+        TurnArena::Stats last_arena;
+
+        // False when no turn follows the next process() (one-shot mode): a
+        // background summary started then would never be applied
+        bool more_turns = true;
+
         explicit Agent(const std::string& session_name);
+        ~Agent();
+        Agent(const Agent&) = delete;
+        Agent& operator=(const Agent&) = delete;
         void process(std::string user_input);
 
-        // Helper to get clean vector for GUI
-        std::vector<ChatMessage> get_display_history();
+        // Appends to the history and its display view
+        void add_message(const std::string& role, const std::string& content);
+
+        // Non-system messages in order; entries are never modified or removed
+        // (trimming on save only affects the session file). Appends pointers to
+        // messages [from, end) to `out`; they stay valid for the Agent's lifetime.
+        void display_since(size_t from, std::vector<const ChatMessage*>& out) const;
+        uint64_t display_version() const { return display_ver.load(std::memory_order_acquire); }
     };
 }
@@ -0,0 +1,53 @@
+#include "Arena.h"
+
+namespace lira
+{
+    void* TurnArena::Blocks::do_allocate(size_t bytes, size_t align) {
+        void* p = std::pmr::new_delete_resource()->allocate(bytes, align);
+        list.emplace_back(static_cast<const char*>(p), bytes);
+        this->bytes += bytes;
+        return p;
+    }
+
+    void TurnArena::Blocks::do_deallocate(void* p, size_t bytes, size_t align) {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    TurnArena::TurnArena(size_t initial_bytes) : arena(initial_bytes, &blocks), previous(active) {
+        active = this;
+    }
+
+    TurnArena::TurnArena(void* buffer, size_t bytes)
+        : local(static_cast<const char*>(buffer)), local_size(bytes), arena(buffer, bytes, &blocks), previous(active) {
+        active = this;
+    }
+
+    TurnArena::~TurnArena() {
+        active = previous;
+        // A nested arena's use counts toward the one it ran in
+        if (previous) {
+            previous->stat.allocations += stat.allocations;
+            previous->stat.bytes += stat.bytes;
+        }
+    }
+
+    bool TurnArena::owned(const void* p) {
+        // Blocks grow geometrically, so there are only a handful to check;
+        // newest first, where most frees land
+        const auto* c = static_cast<const char*>(p);
+        for (const TurnArena* a = active; a; a = a->previous) {
+            if (c >= a->local && c < a->local + a->local_size) return true;
+            for (auto it = a->blocks.list.rbegin(); it != a->blocks.list.rend(); ++it) {
+                if (c >= it->first && c < it->first + it->second) return true;
+            }
+        }
+        return false;
+    }
+
+    TurnArena::Stats TurnArena::stats() const {
+        Stats s = stat;
+        s.blocks = blocks.list.size();
+        s.block_bytes = blocks.bytes;
+        return s;
+    }
+}
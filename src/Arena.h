@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace lira
+{
+    // Monotonic arena for the short-lived data of one agent turn: the request
+    // payloads and the per-chunk parse trees of the stream. Frees are no-ops
+    // and everything is released at once when the arena goes away.
+    //
+    // Constructing a TurnArena makes it the current arena of the thread until
+    // it is destroyed (arenas nest). TurnAllocator draws from the current arena
+    // and falls back to the heap when there is none, so turn_json values work
+    // anywhere -- but a value allocated in an arena must not outlive it.
+    class TurnArena {
+    public:
+        struct Stats {
+            size_t allocations = 0;   // served from the arena
+            size_t bytes = 0;         // requested from the arena
+            size_t blocks = 0;        // obtained from the heap
+            size_t block_bytes = 0;
+        };
+
+        explicit TurnArena(size_t initial_bytes = 64 << 10);
+        // Serves from `buffer` (usually on the stack) before going to the heap;
+        // for short scopes whose memory should stay hot in cache
+        TurnArena(void* buffer, size_t bytes);
+        ~TurnArena();
+        TurnArena(const TurnArena&) = delete;
+        TurnArena& operator=(const TurnArena&) = delete;
+
+        static TurnArena* current() { return active; }
+        // True if `p` came from the current arena or one it is nested in
+        static bool owned(const void* p);
+
+        void* allocate(size_t bytes, size_t align) {
+            stat.allocations++;
+            stat.bytes += bytes;
+            return arena.allocate(bytes, align);
+        }
+
+        Stats stats() const;
+
+    private:
+        // Heap blocks behind the arena, remembered so frees can be recognized
+        class Blocks : public std::pmr::memory_resource {
+        public:
+            std::vector<std::pair<const char*, size_t>> list;
+            size_t bytes = 0;
+
+        private:
+            void* do_allocate(size_t bytes, size_t align) override;
+            void do_deallocate(void* p, size_t bytes, size_t align) override;
+            bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+        };
+
+        Blocks blocks;
+        const char* local = nullptr;  // caller's buffer, checked before the blocks
+        size_t local_size = 0;
+        std::pmr::monotonic_buffer_resource arena;
+        TurnArena* previous;
+        Stats stat;
+
+        static inline thread_local TurnArena* active = nullptr;
+    };
+
+    // Stateless, so nlohmann::basic_json can default-construct it
+    template<class T>
+    struct TurnAllocator {
+        using value_type = T;
+
+        TurnAllocator() noexcept = default;
+        template<class U>
+        TurnAllocator(const TurnAllocator<U>&) noexcept {}
+
+        T* allocate(size_t n) {
+            if (TurnArena* a = TurnArena::current()) return static_cast<T*>(a->allocate(n * sizeof(T), alignof(T)));
+            return std::allocator<T>{}.allocate(n);
+        }
+        void deallocate(T* p, size_t n) noexcept {
+            if (TurnArena::current() && TurnArena::owned(p)) return;
+            // Invariant: arena memory is only freed on the thread that owns the
+            // arena, while it is alive. A value built inside a TurnArena on one
+            // thread and destroyed on another (or after the arena) would land
+            // here and hand arena memory to the heap. Move such values out as
+            // plain std::string/json (as SubAgent::run does with its reply)
+            // before they cross threads.
+            std::allocator<T>{}.deallocate(p, n);
+        }
+
+        friend bool operator==(const TurnAllocator&, const TurnAllocator&) noexcept { return true; }
+    };
+
+    using turn_string = std::basic_string<char, std::char_traits<char>, TurnAllocator<char>>;
+    using turn_json = nlohmann::basic_json<std::map, std::vector, turn_string, bool, std::int64_t, std::uint64_t, double, TurnAllocator>;
+}
@@ -0,0 +1,105 @@
+#include "Document.h"
+#include <algorithm>
+
+namespace lira
+{
+    DocBlock& Document::open_block(DocBlock::Kind kind) {
+        close_block();
+        auto& block = blocks_.emplace_back();
+        block.kind = kind;
+        return block;
+    }
+
+    // Trailing newlines belong to the block separator, not the content
+    void Document::close_block() {
+        if (blocks_.empty() || blocks_.back().complete) return;
+        auto& block = blocks_.back();
+        while (!block.text.empty() && block.text.back() == '\n') block.text.pop_back();
+        const auto size = static_cast<uint32_t>(block.text.size());
+        while (!block.spans.empty() && block.spans.back().begin >= size) block.spans.pop_back();
+        if (!block.spans.empty()) block.spans.back().end = std::min(block.spans.back().end, size);
+        block.complete = true;
+        ++block.version;
+        ++version_;
+        // Blank-line noise between blocks leaves nothing to draw
+        if (block.text.empty() && block.kind == DocBlock::Kind::Paragraph) blocks_.pop_back();
+    }
+
+    void Document::add_span(DocBlock& block, TokenType style, std::string_view text) {
+        if (text.empty()) return;
+        const auto begin = static_cast<uint32_t>(block.text.size());
+        block.text += text;
+        const auto end = static_cast<uint32_t>(block.text.size());
+        if (!block.spans.empty() && block.spans.back().style == style && block.spans.back().end == begin) {
+            block.spans.back().end = end;
+        } else {
+            block.spans.push_back({style, begin, end});
+        }
+        ++block.version;
+        ++version_;
+    }
+
+    // Paragraph text; a blank line ends the paragraph
+    void Document::add_text(TokenType style, std::string_view text) {
+        while (!text.empty()) {
+            if (blocks_.empty() || blocks_.back().complete || blocks_.back().kind != DocBlock::Kind::Paragraph) {
+                // Leading newlines of a new paragraph are separator
+                while (!text.empty() && text.front() == '\n') text.remove_prefix(1);
+                if (text.empty()) return;
+                open_block(DocBlock::Kind::Paragraph);
+            }
+            auto& block = blocks_.back();
+
+            size_t cut = std::string_view::npos;
+            for (size_t i = 0; i < text.size(); ++i) {
+                if (text[i] != '\n') continue;
+                const bool after_newline = i > 0 ? text[i - 1] == '\n' : block.text.ends_with('\n');
+                if (after_newline) { cut = i; break; }
+            }
+            if (cut == std::string_view::npos) { add_span(block, style, text); return; }
+
+            add_span(block, style, text.substr(0, cut));
+            close_block();
+            text.remove_prefix(cut + 1);
+        }
+    }
+
+    void Document::append(TokenType type, std::string_view content) {
+        switch (type) {
+        case TokenType::CodeBlockStart:
+            open_block(DocBlock::Kind::Code).lang = content;
+            ++version_;
+            break;
+        case TokenType::CodeBlockContent:
+        case TokenType::CodeKeyword:
+        case TokenType::CodeString:
+        case TokenType::CodeComment:
+        case TokenType::CodeNumber:
+            // One-line fences emit content without a start token
+            if (blocks_.empty() || blocks_.back().complete || blocks_.back().kind != DocBlock::Kind::Code) open_block(DocBlock::Kind::Code);
+            add_span(blocks_.back(), type, content);
+            break;
+        case TokenType::CodeBlockEnd:
+            close_block();
+            break;
+        case TokenType::Thinking:
+            // Spinner ticks only; not part of the document
+            break;
+        case TokenType::Text:
+        case TokenType::Bold:
+        case TokenType::InlineCode:
+        case TokenType::ToolOutput:
+            add_text(type, content);
+            break;
+        }
+    }
+
+    void Document::finish() {
+        close_block();
+    }
+
+    void Document::clear() {
+        blocks_.clear();
+        ++version_;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "StreamRenderer.h"
+
+namespace lira
+{
+    // Styled range of a block's text
+    struct DocSpan {
+        TokenType style;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    struct DocBlock {
+        enum class Kind { Paragraph, Code };
+        Kind kind = Kind::Paragraph;
+        std::string lang;            // code blocks only
+        std::string text;
+        std::vector<DocSpan> spans;
+        uint64_t version = 0;        // bumped on every change
+        bool complete = false;       // completed blocks never change again
+    };
+
+    // Markdown document built incrementally from StreamRenderer tokens.
+    // Blocks are paragraphs (split on blank lines) and fenced code blocks; only
+    // the last block can still grow, so views can cache the layout of every
+    // completed block and redo just the tail while a response streams in.
+    class Document {
+        std::vector<DocBlock> blocks_;
+        uint64_t version_ = 0;
+
+        DocBlock& open_block(DocBlock::Kind kind);
+        void close_block();
+        void add_span(DocBlock& block, TokenType style, std::string_view text);
+        void add_text(TokenType style, std::string_view text);
+
+    public:
+        // RenderCallback-compatible sink
+        void append(TokenType type, std::string_view content);
+        // Completes the trailing block (end of message)
+        void finish();
+        void clear();
+
+        const std::vector<DocBlock>& blocks() const { return blocks_; }
+        uint64_t version() const { return version_; }
+    };
+}
@@ -2,14 +2,21 @@
 // Created by cv2 on 14.12.2025.
 //
 #pragma once
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <nlohmann/json_fwd.hpp>
 #include <filesystem>
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <set>
 
+#include "Arena.h"
+#include "Metrics.h"
 #include "StreamRenderer.h"
+#include "StreamStats.h"
+#include "Trace.h"
 
 namespace lira
 {
@@ -21,7 +28,11 @@ namespace lira
     // Using inline const to allow definition in header without ODR violations
     inline const std::string BASE_DIR = std::string(getenv("HOME")) + "/.lira";
     inline const std::string SESSIONS_DIR = BASE_DIR + "/sessions";
-    inline const std::string NEXUS_FILE = BASE_DIR + "/data/nexus.json";
+    inline const std::string NEXUS_FILE = BASE_DIR + "/data/nexus.json"; // legacy, imported once
+    inline const std::string NEXUS_DB = BASE_DIR + "/data/nexus.db";
+    inline const std::string SEARCH_CACHE_DIR = BASE_DIR + "/cache/search";
+    inline const std::string METRICS_DB = BASE_DIR + "/data/metrics.db";
+    inline const std::string ROUTER_LOG = BASE_DIR + "/data/router.log";
 
     // ANSI Colors
     inline const std::string ANSI_RESET   = "\033[0m";
@@ -53,60 +64,273 @@ namespace lira
 
     // --- Helper Functions ---
 
+    // Chat completions endpoint; any OpenAI-compatible streaming server works
+    inline std::string get_api_url() {
+        const char* env_url = std::getenv("LIRA_API_URL");
+        return env_url ? std::string(env_url) : "https://openrouter.ai/api/v1/chat/completions";
+    }
+
     inline std::string get_model() {
         const char* env_model = std::getenv("LIRA_MODEL");
         return env_model ? std::string(env_model) : "openai/gpt-4o-mini";
     }
 
+    // Comma-separated fast models for cheap rounds; empty sends everything to get_model()
+    inline std::vector<std::string> get_fast_models() {
+        std::vector<std::string> models;
+        const char* env_m = std::getenv("LIRA_FAST_MODELS");
+        if (!env_m) return models;
+        std::string_view list(env_m);
+        while (!list.empty()) {
+            const auto comma = list.find(',');
+            std::string_view m = list.substr(0, comma);
+            while (!m.empty() && m.front() == ' ') m.remove_prefix(1);
+            while (!m.empty() && m.back() == ' ') m.remove_suffix(1);
+            if (!m.empty()) models.emplace_back(m);
+            if (comma == std::string_view::npos) break;
+            list.remove_prefix(comma + 1);
+        }
+        return models;
+    }
+
+    // MinHash similarity at or above which a new memory replaces an old one.
+    // Facts from one template with different values ("prefers vim" / "prefers
+    // emacs", two projects with their ports) score 0.55-0.70 and rewordings
+    // of one fact 0.75-0.9, so lower values merge distinct facts.
+    inline double get_nexus_dedup_threshold() {
+        const char* env_t = std::getenv("LIRA_NEXUS_DEDUP");
+        if (!env_t) return 0.85;
+        try { return std::clamp(std::stod(env_t), 0.0, 1.0); } catch (...) { return 0.85; }
+    }
+
+    // Seconds a cached search result counts as fresh; 0 disables the cache
+    inline long get_search_cache_ttl() {
+        const char* env_t = std::getenv("LIRA_SEARCH_CACHE_TTL");
+        if (!env_t) return 6 * 3600;
+        try { return std::max(0L, std::stol(env_t)); } catch (...) { return 6 * 3600; }
+    }
+
+    // Seconds past the TTL a result may still be served while it is refreshed
+    inline long get_search_cache_stale() {
+        const char* env_t = std::getenv("LIRA_SEARCH_CACHE_STALE");
+        if (!env_t) return 3 * 24 * 3600;
+        try { return std::max(0L, std::stol(env_t)); } catch (...) { return 3 * 24 * 3600; }
+    }
+
+    // Search page endpoint; point it at a local stand-in for testing
+    inline std::string get_search_endpoint() {
+        const char* env_url = std::getenv("LIRA_SEARCH_URL");
+        return env_url ? std::string(env_url) : "https://www.google.com/search";
+    }
+
+    // Parallel connections per host during a search batch
+    inline long get_search_host_connections() {
+        const char* env_n = std::getenv("LIRA_SEARCH_HOST_CONNECTIONS");
+        if (!env_n) return 2;
+        try { return std::clamp(std::stol(env_n), 1L, 16L); } catch (...) { return 2; }
+    }
+
+    // Result pages fetched per query alongside the snippets
+    inline size_t get_search_fetch_pages() {
+        const char* env_n = std::getenv("LIRA_SEARCH_FETCH_PAGES");
+        if (!env_n) return 0;
+        try { return static_cast<size_t>(std::clamp(std::stol(env_n), 0L, 10L)); } catch (...) { return 0; }
+    }
+
+    // Overall time budget of one search batch, in milliseconds
+    inline long get_search_deadline_ms() {
+        const char* env_ms = std::getenv("LIRA_SEARCH_DEADLINE_MS");
+        if (!env_ms) return 10000;
+        try { return std::max(100L, std::stol(env_ms)); } catch (...) { return 10000; }
+    }
+
+    // Bytes of page text a <fetch> returns before the transfer is cut off
+    inline size_t get_fetch_budget() {
+        const char* env_n = std::getenv("LIRA_FETCH_BUDGET");
+        if (!env_n) return 8000;
+        try { return static_cast<size_t>(std::max(500L, std::stol(env_n))); } catch (...) { return 8000; }
+    }
+
+    // Characters of unsummarized history that start a background summary; 0 disables
+    inline size_t get_compact_chars() {
+        const char* env_n = std::getenv("LIRA_COMPACT_CHARS");
+        if (!env_n) return 24000;
+        try { return static_cast<size_t>(std::max(0L, std::stol(env_n))); } catch (...) { return 24000; }
+    }
+
+    // Cheap model that writes the history summaries
+    inline std::string get_summary_model() {
+        const char* env_model = std::getenv("LIRA_SUMMARY_MODEL");
+        return env_model ? std::string(env_model) : "openai/gpt-4o-mini";
+    }
+
+    // Worker threads running <spawn> sub-agents
+    inline size_t get_spawn_workers() {
+        const char* env_n = std::getenv("LIRA_SPAWN_WORKERS");
+        if (!env_n) return 4;
+        try { return static_cast<size_t>(std::clamp(std::stol(env_n), 1L, 32L)); } catch (...) { return 4; }
+    }
+
+    // Model requests all sub-agents of one turn may make together; 0 disables <spawn>
+    inline long get_spawn_requests() {
+        const char* env_n = std::getenv("LIRA_SPAWN_REQUESTS");
+        if (!env_n) return 24;
+        try { return std::max(0L, std::stol(env_n)); } catch (...) { return 24; }
+    }
+
+    // LIRA_TURN_ARENA=0 puts turn payloads back on the global heap (for comparisons)
+    inline bool get_turn_arena_enabled() {
+        const char* env_a = std::getenv("LIRA_TURN_ARENA");
+        return !env_a || std::string(env_a) != "0";
+    }
+
+    // LIRA_METRICS=0 stops recording usage metrics
+    inline bool get_metrics_enabled() {
+        const char* env_m = std::getenv("LIRA_METRICS");
+        return !env_m || std::string(env_m) != "0";
+    }
+
+    // Size budget of the search cache directory
+    inline uint64_t get_search_cache_bytes() {
+        const char* env_mb = std::getenv("LIRA_SEARCH_CACHE_MB");
+        if (!env_mb) return 16ull << 20;
+        try { return static_cast<uint64_t>(std::max(1L, std::stol(env_mb))) << 20; } catch (...) { return 16ull << 20; }
+    }
 
-    struct StreamContext {lira::StreamRenderer* renderer{}; std::string buffer; };
+
+    struct StreamContext {lira::StreamRenderer* renderer{}; std::string buffer; StreamStats* stats{}; Metrics::Model metrics; const std::atomic<bool>* cancel{}; };
     inline size_t StreamCallback(void* ptr, const size_t size, const size_t nmemb, void* userdata) {
         const size_t real_size = size * nmemb;
         auto* ctx = static_cast<StreamContext*>(userdata);
+        // A short count makes curl abort the transfer
+        if (ctx->cancel && ctx->cancel->load(std::memory_order_relaxed)) return 0;
         ctx->buffer.append(static_cast<char*>(ptr), real_size);
-        size_t pos;
-        while ((pos = ctx->buffer.find('\n')) != std::string::npos) {
-            std::string line = ctx->buffer.substr(0, pos);
-            ctx->buffer.erase(0, pos + 1);
+        // Lines are parsed in place and the consumed prefix dropped once per write
+        size_t start = 0, pos;
+        while ((pos = ctx->buffer.find('\n', start)) != std::string::npos) {
+            const std::string_view line(ctx->buffer.data() + start, pos - start);
+            start = pos + 1;
             if (line.starts_with("data: ")) {
-                std::string json_str = line.substr(6);
-                if (json_str == "[DONE]") return real_size;
+                const std::string_view json_str = line.substr(6);
+                if (json_str == "[DONE]") break;
                 try {
-                    if (json j = json::parse(json_str); j.contains("choices") && !j["choices"].empty()) {
+                    // Within a turn arena each event's parse tree lives in a
+                    // stack buffer that is reused for the next event, instead
+                    // of piling up cold in the turn arena
+                    alignas(std::max_align_t) char scratch[8192];
+                    std::optional<TurnArena> event_arena;
+                    if (TurnArena::current()) event_arena.emplace(scratch, sizeof(scratch));
+                    if (turn_json j = turn_json::parse(json_str); j.contains("choices") && !j["choices"].empty()) {
                         if (auto& delta = j["choices"][0]["delta"]; delta.contains("content") && !delta["content"].is_null()) {
-                            ctx->renderer->print(delta["content"]);
+                            if (ctx->stats) {
+                                const auto now = std::chrono::steady_clock::now();
+                                if (ctx->stats->deltas++ == 0) ctx->stats->first_delta = now;
+                                else ctx->metrics.record(Metrics::TOKEN_GAP_US, std::chrono::duration_cast<std::chrono::microseconds>(now - ctx->stats->last_delta).count());
+                                ctx->stats->last_delta = now;
+                            }
+                            ctx->renderer->print(delta["content"].get_ref<const turn_string&>());
                         }
                     }
                 } catch (...) {}
             }
         }
+        ctx->buffer.erase(0, start);
         return real_size;
     }
 
-    inline void http_post_stream(const std::string& url, const json& payload, const std::string& api_key, lira::StreamRenderer& renderer) {
+    inline void record_request_metrics(const Metrics::Model& m, const StreamStats& stats) {
+        using us = std::chrono::microseconds;
+        if (!stats.completed || stats.http_status >= 400) m.add(Metrics::FAILED_REQUESTS);
+        m.record(Metrics::REQUEST_US, std::chrono::duration_cast<us>(stats.end - stats.start).count());
+        if (!stats.deltas) return;
+        m.add(Metrics::TOKENS, stats.deltas);
+        m.record(Metrics::TTFT_US, std::chrono::duration_cast<us>(stats.first_delta - stats.start).count());
+        if (const double tps = stats.tokens_per_second(); tps > 0) m.record(Metrics::TOKENS_PER_S, static_cast<uint64_t>(tps * 100));
+    }
+
+    // Splits a finished request into connect / TLS / server wait / first token /
+    // streaming phases from curl's timers, so the trace shows where it went
+    inline void trace_request_phases(CURL* curl, const StreamStats& stats) {
+        curl_off_t connect = 0, tls = 0, first_byte = 0;
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+        curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+        const auto at = [&](curl_off_t us) { return stats.start + std::chrono::microseconds(us); };
+        const auto connected = at(std::max(connect, tls));
+        trace::record("http", "connect", stats.start, at(connect));
+        if (tls > 0) trace::record("http", "tls", at(connect), at(tls));
+        if (first_byte > 0) trace::record("http", "wait_first_byte", connected, at(first_byte));
+        if (stats.deltas) {
+            // OpenRouter sends keep-alive comments before the model produces anything
+            trace::record("http", "wait_first_token", at(first_byte), stats.first_delta);
+            trace::record("http", "stream", stats.first_delta, stats.end);
+        }
+    }
+
+    // Also polled while no data arrives, so a cancelled request doesn't wait for the server
+    inline int CancelCallback(void* userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        const auto* cancel = static_cast<const std::atomic<bool>*>(userdata);
+        return cancel->load(std::memory_order_relaxed) ? 1 : 0;
+    }
+
+    // `payload` is a json or turn_json. Setting `*cancel` aborts the request.
+    template<class Json>
+    inline void http_post_stream(const std::string& url, const Json& payload, const std::string& api_key, lira::StreamRenderer& renderer,
+                                 StreamStats* stats = nullptr, const std::atomic<bool>* cancel = nullptr) {
+        trace::Span span("http", "http_post_stream");
+        StreamStats local;
+        if (!stats) stats = &local;
+        const auto metrics = Metrics::shared()->model(payload.value("model", ""));
         CURL* curl = curl_easy_init();
-        StreamContext ctx; ctx.renderer = &renderer;
+        StreamContext ctx; ctx.renderer = &renderer; ctx.stats = stats; ctx.metrics = metrics; ctx.cancel = cancel;
+        stats->start = std::chrono::steady_clock::now();
         if(curl) {
             struct curl_slist* headers = nullptr;
             headers = curl_slist_append(headers, ("Authorization: Bearer " + api_key).c_str());
             headers = curl_slist_append(headers, "Content-Type: application/json");
             headers = curl_slist_append(headers, "HTTP-Referer: https://github.com/lira-agent");
             headers = curl_slist_append(headers, "X-Title: Lira Agent");
-            const std::string json_str = payload.dump();
+            typename Json::string_t json_str;
+            {
+                trace::Span dump("http", "serialize_payload");
+                json_str = payload.dump();
+                dump.arg("bytes", static_cast<double>(json_str.size()));
+            }
+            metrics.add(Metrics::REQUESTS);
+            metrics.record(Metrics::REQUEST_BYTES, json_str.size());
             curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
             curl_easy_setopt(curl, CURLOPT_POST, 1L);
             curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_str.c_str());
             curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
             curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, StreamCallback);
             curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ctx);
-            curl_easy_perform(curl);
+            if (cancel) {
+                curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, CancelCallback);
+                curl_easy_setopt(curl, CURLOPT_XFERINFODATA, cancel);
+                curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+            }
+            const CURLcode res = curl_easy_perform(curl);
+            stats->completed = res == CURLE_OK;
+            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &stats->http_status);
+            stats->end = std::chrono::steady_clock::now();
+            record_request_metrics(metrics, *stats);
+            if (span) {
+                trace_request_phases(curl, *stats);
+                span.arg("url", url);
+                span.arg("status", static_cast<double>(stats->http_status));
+                span.arg("deltas", static_cast<double>(stats->deltas));
+                if (res != CURLE_OK) span.arg("error", curl_easy_strerror(res));
+            }
             curl_easy_cleanup(curl);
             curl_slist_free_all(headers);
         }
         renderer.finish();
+        stats->end = std::chrono::steady_clock::now();
     }
 
     inline std::string exec_command(const char* cmd) {
+        trace::Span span("tool", "exec_command");
+        span.arg("cmd", cmd);
         char buffer[128];
         std::string result;
         const std::unique_ptr<FILE, decltype(&pclose)> pipe(popen(cmd, "r"), pclose);
@@ -0,0 +1,374 @@
+#include "Html.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace lira::html
+{
+    // --- Character References ---
+    struct NamedEntity { std::string_view name; std::string_view utf8; };
+    // &nbsp; maps to a plain space: search output is plain text
+    constexpr NamedEntity NAMED_ENTITIES[] = {
+        {"amp", "&"}, {"lt", "<"}, {"gt", ">"}, {"quot", "\""}, {"apos", "'"}, {"nbsp", " "},
+        {"middot", "·"}, {"mdash", "—"}, {"ndash", "–"}, {"hellip", "…"},
+        {"rsaquo", "›"}, {"lsaquo", "‹"}, {"raquo", "»"}, {"laquo", "«"},
+        {"rsquo", "’"}, {"lsquo", "‘"}, {"rdquo", "”"}, {"ldquo", "“"},
+        {"bull", "•"}, {"copy", "©"}, {"reg", "®"}, {"trade", "™"},
+        {"times", "×"}, {"deg", "°"}, {"euro", "€"}, {"zwj", ""}, {"zwnj", ""},
+    };
+    constexpr size_t MAX_ENTITY = 32;
+
+    static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f'; }
+    static bool is_alpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+    static char lower(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; }
+
+    void append_utf8(std::string& out, uint32_t cp) {
+        if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) cp = 0xFFFD;
+        if (cp < 0x80) out += static_cast<char>(cp);
+        else if (cp < 0x800) { out += static_cast<char>(0xC0 | (cp >> 6)); out += static_cast<char>(0x80 | (cp & 0x3F)); }
+        else if (cp < 0x10000) { out += static_cast<char>(0xE0 | (cp >> 12)); out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F)); out += static_cast<char>(0x80 | (cp & 0x3F)); }
+        else { out += static_cast<char>(0xF0 | (cp >> 18)); out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F)); out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F)); out += static_cast<char>(0x80 | (cp & 0x3F)); }
+    }
+
+    // `ref` is the text between '&' and ';'. Returns false if it isn't a known reference.
+    static bool decode_reference(std::string_view ref, std::string& out) {
+        if (ref.size() > 1 && ref[0] == '#') {
+            const bool hex = ref[1] == 'x' || ref[1] == 'X';
+            uint32_t cp = 0;
+            size_t digits = 0;
+            for (char c : ref.substr(hex ? 2 : 1)) {
+                int d;
+                if (c >= '0' && c <= '9') d = c - '0';
+                else if (hex && lower(c) >= 'a' && lower(c) <= 'f') d = lower(c) - 'a' + 10;
+                else return false;
+                if (cp < 0x110000) cp = cp * (hex ? 16 : 10) + d;
+                ++digits;
+            }
+            if (digits == 0) return false;
+            append_utf8(out, cp == 0xA0 ? ' ' : cp);
+            return true;
+        }
+        for (const auto& e : NAMED_ENTITIES) {
+            if (e.name == ref) { out += e.utf8; return true; }
+        }
+        return false;
+    }
+
+    void decode_entities(std::string_view in, std::string& out) {
+        size_t i = 0;
+        while (i < in.size()) {
+            const size_t amp = in.find('&', i);
+            if (amp == std::string_view::npos) { out.append(in.substr(i)); return; }
+            out.append(in.substr(i, amp - i));
+            const size_t semi = in.find(';', amp + 1);
+            if (semi != std::string_view::npos && semi - amp - 1 <= MAX_ENTITY && decode_reference(in.substr(amp + 1, semi - amp - 1), out)) {
+                i = semi + 1;
+            } else {
+                out += '&';
+                i = amp + 1;
+            }
+        }
+    }
+
+    // --- Text Extraction ---
+    static bool in_list(std::string_view name, std::initializer_list<std::string_view> names) {
+        for (auto n : names) if (n == name) return true;
+        return false;
+    }
+
+    static bool is_void(std::string_view name) {
+        return in_list(name, {"br", "img", "input", "hr", "meta", "link", "source", "wbr", "area", "col", "embed", "track"});
+    }
+
+    static bool is_block(std::string_view name) {
+        return in_list(name, {
+            "p", "div", "br", "li", "ul", "ol", "tr", "table", "section", "article", "main", "header", "footer",
+            "h1", "h2", "h3", "h4", "h5", "h6", "pre", "blockquote", "dd", "dt", "hr", "form", "figure"
+        });
+    }
+
+    // Elements whose subtree is never content. Site headers and footers only
+    // count outside <main>/<article>, where they are usually the title block.
+    static bool is_boilerplate(const Tag& tag, bool in_main) {
+        if (in_list(tag.name, {"head", "title", "noscript", "template", "svg", "select", "nav", "aside", "form",
+                               "button", "iframe", "menu", "dialog", "object"})) return true;
+        if (!in_main && (tag.name == "header" || tag.name == "footer")) return true;
+        if (tag.attr("aria-hidden") == "true") return true;
+        for (const auto& [k, v] : tag.attrs) if (k == "hidden") return true;
+        const std::string_view role = tag.attr("role");
+        return in_list(role, {"navigation", "banner", "contentinfo", "complementary", "search", "menu", "dialog"});
+    }
+
+    static bool is_main(const Tag& tag) {
+        return tag.name == "main" || tag.name == "article" || tag.attr("role") == "main";
+    }
+
+    void TextCollector::on_open(const Tag& tag) {
+        if (skip.active()) {
+            if (tag.name == skip.name && !tag.self_closing) ++skip.nesting;
+            return;
+        }
+        if (!is_void(tag.name) && !tag.self_closing) {
+            if (is_boilerplate(tag, main.active())) { skip = {tag.name, 1}; return; }
+            if (main.active()) {
+                if (tag.name == main.name) ++main.nesting;
+            } else if (is_main(tag)) {
+                main = {tag.name, 1};
+                seen_main = true;
+            }
+        }
+        if (is_block(tag.name)) add_break(tag.name == "p" || tag.name[0] == 'h' ? 2 : 1);
+    }
+
+    void TextCollector::on_close(std::string_view name) {
+        if (skip.active()) {
+            if (name == skip.name && --skip.nesting == 0) skip = {};
+            return;
+        }
+        if (main.active() && name == main.name && --main.nesting == 0) main = {};
+        if (is_block(name)) add_break(name == "p" || name[0] == 'h' ? 2 : 1);
+    }
+
+    void TextCollector::on_text(std::string_view chunk) {
+        if (skip.active() || truncated) return;
+        size_t i = 0;
+        while (i < chunk.size()) {
+            if (is_space(chunk[i])) { region().pending_space = true; ++i; continue; }
+            size_t j = i;
+            while (j < chunk.size() && !is_space(chunk[j])) ++j;
+            put(chunk.substr(i, j - i));
+            i = j;
+        }
+    }
+
+    void TextCollector::add_break(int n) {
+        Region& r = region();
+        r.pending_breaks = std::max(r.pending_breaks, n);
+    }
+
+    // Appends a word with the separator the markup before it called for
+    void TextCollector::put(std::string_view word) {
+        Region& r = region();
+        if (!r.text.empty()) {
+            if (r.pending_breaks > 0) r.text.append(static_cast<size_t>(r.pending_breaks), '\n');
+            else if (r.pending_space) r.text += ' ';
+        }
+        r.pending_breaks = 0;
+        r.pending_space = false;
+        r.text.append(word);
+
+        if (content.text.size() >= budget || (!seen_main && rest.text.size() >= 2 * budget)) {
+            truncated = true;
+            if (tokenizer) tokenizer->stop();
+        }
+    }
+
+    std::string TextCollector::take() {
+        std::string& text = content.text.empty() ? rest.text : content.text;
+        if (text.size() > budget) {
+            // Cut at the last word boundary inside the budget
+            const size_t cut = text.find_last_of(" \n", budget);
+            text.resize(cut == std::string::npos || cut == 0 ? budget : cut);
+            truncated = true;
+        }
+        return std::move(text);
+    }
+
+    // --- Tokenizer ---
+    void Tokenizer::flush_text() {
+        if (text.empty()) return;
+        sink.on_text(text);
+        text.clear(); // keeps capacity
+    }
+
+    void Tokenizer::emit_tag() {
+        flush_text();
+        if (closing) {
+            sink.on_close(tag.name);
+        } else {
+            sink.on_open(tag);
+            // Contents of these are not markup and never shown
+            if (!tag.self_closing && (tag.name == "script" || tag.name == "style")) {
+                raw_closer.assign("</");
+                raw_closer += tag.name;
+                raw_matched = 0;
+                state = State::RawText;
+                return;
+            }
+        }
+        state = State::Data;
+    }
+
+    void Tokenizer::finish_attr() {
+        if (attr_name.empty()) return;
+        std::string value;
+        decode_entities(attr_value, value);
+        tag.attrs.emplace_back(std::move(attr_name), std::move(value));
+        attr_name.clear();
+        attr_value.clear();
+    }
+
+    // Entity in text ended by `next` (';' or something else). Attribute
+    // values are decoded as a whole in finish_attr().
+    void Tokenizer::end_entity(char next) {
+        state = State::Data;
+        if (next == ';' && decode_reference(std::string_view(entity).substr(1), text)) {
+            entity.clear();
+            return;
+        }
+        text += entity;
+        entity.clear();
+        if (next != ';') step(next);
+        else text += ';';
+    }
+
+    void Tokenizer::step(char c) {
+        switch (state) {
+        case State::Data:
+            if (c == '<') { state = State::TagOpen; return; }
+            if (c == '&') { entity = "&"; state = State::Entity; return; }
+            text += c;
+            return;
+
+        case State::Entity:
+            if (c == ';' || !(is_alpha(c) || (c >= '0' && c <= '9') || c == '#') || entity.size() > MAX_ENTITY) { end_entity(c); return; }
+            entity += c;
+            return;
+
+        case State::TagOpen:
+            tag.name.clear();
+            tag.attrs.clear();
+            tag.self_closing = false;
+            if (is_alpha(c)) { closing = false; tag.name += lower(c); state = State::TagName; return; }
+            if (c == '/') { closing = true; end_name_done = false; state = State::EndTagName; return; }
+            if (c == '!') { dashes = 0; state = State::MarkupDecl; return; }
+            if (c == '?') { state = State::Bogus; return; }
+            // A lone '<' is text
+            text += '<';
+            state = State::Data;
+            step(c);
+            return;
+
+        case State::TagName:
+            if (is_space(c)) { state = State::BeforeAttr; return; }
+            if (c == '/') { state = State::SelfClosing; return; }
+            if (c == '>') { emit_tag(); return; }
+            tag.name += lower(c);
+            return;
+
+        case State::EndTagName:
+            if (c == '>') { emit_tag(); return; }
+            if (is_space(c)) end_name_done = !tag.name.empty();
+            else if (!end_name_done) tag.name += lower(c);
+            return;
+
+        case State::BeforeAttr:
+            if (is_space(c)) return;
+            if (c == '>') { emit_tag(); return; }
+            if (c == '/') { state = State::SelfClosing; return; }
+            attr_name += lower(c);
+            state = State::AttrName;
+            return;
+
+        case State::AttrName:
+            if (c == '=') { state = State::BeforeValue; return; }
+            if (is_space(c)) { state = State::AfterAttrName; return; }
+            if (c == '>') { finish_attr(); emit_tag(); return; }
+            if (c == '/') { finish_attr(); state = State::SelfClosing; return; }
+            attr_name += lower(c);
+            return;
+
+        case State::AfterAttrName:
+            if (is_space(c)) return;
+            if (c == '=') { state = State::BeforeValue; return; }
+            finish_attr();
+            state = State::BeforeAttr;
+            step(c);
+            return;
+
+        case State::BeforeValue:
+            if (is_space(c)) return;
+            if (c == '"' || c == '\'') { quote = c; state = State::ValueQuoted; return; }
+            if (c == '>') { finish_attr(); emit_tag(); return; }
+            attr_value += c;
+            state = State::ValueUnquoted;
+            return;
+
+        case State::ValueQuoted:
+            if (c == quote) { finish_attr(); state = State::BeforeAttr; return; }
+            attr_value += c; // decoded in finish_attr()
+            return;
+
+        case State::ValueUnquoted:
+            if (is_space(c)) { finish_attr(); state = State::BeforeAttr; return; }
+            if (c == '>') { finish_attr(); emit_tag(); return; }
+            attr_value += c;
+            return;
+
+        case State::SelfClosing:
+            if (c == '>') { tag.self_closing = true; emit_tag(); return; }
+            state = State::BeforeAttr;
+            step(c);
+            return;
+
+        case State::MarkupDecl:
+            // "<!--" starts a comment, anything else (<!DOCTYPE ...>) is skipped
+            if (c == '-' && ++dashes == 2) { dashes = 0; state = State::Comment; return; }
+            if (c == '-') return;
+            state = State::Bogus;
+            step(c);
+            return;
+
+        case State::Comment:
+            if (c == '>' && dashes >= 2) { state = State::Data; return; }
+            dashes = (c == '-') ? dashes + 1 : 0;
+            return;
+
+        case State::Bogus:
+            if (c == '>') state = State::Data;
+            return;
+
+        case State::RawText:
+            if (raw_matched >= raw_closer.size()) {
+                // "</script" matched: the end tag is complete at '>'; anything
+                // after the name is skipped (size + 1), "</scripts" is content
+                if (c == '>') {
+                    flush_text();
+                    sink.on_close(std::string_view(raw_closer).substr(2));
+                    state = State::Data;
+                } else if (raw_matched > raw_closer.size() || is_space(c) || c == '/') {
+                    raw_matched = raw_closer.size() + 1;
+                } else {
+                    raw_matched = (c == '<') ? 1 : 0;
+                }
+                return;
+            }
+            if (lower(c) == raw_closer[raw_matched]) ++raw_matched;
+            else raw_matched = (c == '<') ? 1 : 0;
+            return;
+        }
+    }
+
+    void Tokenizer::feed(std::string_view chunk) {
+        size_t i = 0;
+        while (i < chunk.size() && !stopped) {
+            // Fast path: plain text up to the next markup or reference
+            if (state == State::Data) {
+                size_t j = i;
+                while (j < chunk.size() && chunk[j] != '<' && chunk[j] != '&') ++j;
+                text.append(chunk.data() + i, j - i);
+                i = j;
+                if (i == chunk.size()) break;
+            }
+            step(chunk[i++]);
+        }
+        if (state == State::Data || state == State::RawText) flush_text();
+    }
+
+    void Tokenizer::finish() {
+        if (stopped) return;
+        if (state == State::Entity) { text += entity; entity.clear(); }
+        if (state == State::TagOpen) text += '<';
+        state = State::Data;
+        flush_text();
+    }
+}
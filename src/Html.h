@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lira::html
+{
+    struct Tag {
+        std::string name;                                        // lower-case
+        std::vector<std::pair<std::string, std::string>> attrs;  // values entity-decoded
+        bool self_closing = false;
+
+        std::string_view attr(std::string_view key) const {
+            for (const auto& [k, v] : attrs) if (k == key) return v;
+            return {};
+        }
+    };
+
+    // Receives tokenizer events in document order. Text arrives entity-decoded
+    // and possibly split across calls; script/style contents are skipped.
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+        virtual void on_open(const Tag& /*tag*/) {}
+        virtual void on_close(std::string_view /*name*/) {}
+        virtual void on_text(std::string_view /*text*/) {}
+    };
+
+    // Single-pass, streaming HTML tokenizer. feed() accepts arbitrary chunks
+    // (e.g. straight from a curl write callback); state carries across calls,
+    // so every byte is looked at once and nothing is buffered beyond the
+    // current tag or entity.
+    class Tokenizer {
+        enum class State {
+            Data, Entity, TagOpen, TagName, EndTagName, BeforeAttr, AttrName, AfterAttrName,
+            BeforeValue, ValueQuoted, ValueUnquoted, SelfClosing, MarkupDecl, Comment, Bogus, RawText
+        };
+
+        Sink& sink;
+        State state = State::Data;
+        std::string text;            // pending decoded text
+        std::string entity;          // "&..." being collected
+        Tag tag;
+        bool closing = false;
+        bool end_name_done = false;  // rest of "</name ...>" is ignored
+        std::string attr_name, attr_value;
+        char quote = 0;
+        int dashes = 0;              // comment end detection
+        std::string raw_closer;      // "</script" while inside raw text
+        size_t raw_matched = 0;
+        bool stopped = false;
+
+        void flush_text();
+        void emit_tag();
+        void finish_attr();
+        void end_entity(char next);
+        void step(char c);
+
+    public:
+        explicit Tokenizer(Sink& s) : sink(s) {}
+
+        void feed(std::string_view chunk);
+        void finish();
+        // Ignores further input (e.g. a text budget was reached)
+        void stop() { stopped = true; }
+        bool is_stopped() const { return stopped; }
+    };
+
+    // Extracts the readable text of a page while it streams in. Whitespace is
+    // collapsed and block elements become line breaks. Boilerplate (nav,
+    // aside, site header/footer, forms, ARIA landmarks around them) is
+    // dropped. Text inside <main>/<article> is kept apart from the rest and
+    // wins if there is any. The attached tokenizer is stopped once `budget`
+    // bytes of main text are in, or twice that with no main element seen.
+    class TextCollector : public Sink {
+        struct Region {
+            std::string text;
+            bool pending_space = false;
+            int pending_breaks = 0;
+        };
+        // An element whose whole subtree is treated alike
+        struct Scope {
+            std::string name;
+            int nesting = 0;
+            bool active() const { return !name.empty(); }
+        };
+
+        Tokenizer* tokenizer = nullptr;
+        size_t budget;
+        Region content, rest;
+        Scope skip, main;
+        bool seen_main = false;
+
+        Region& region() { return main.active() ? content : rest; }
+        void put(std::string_view word);
+        void add_break(int n);
+
+    public:
+        bool truncated = false;
+
+        explicit TextCollector(size_t budget) : budget(budget) {}
+        void attach(Tokenizer& t) { tokenizer = &t; }
+
+        void on_open(const Tag& tag) override;
+        void on_close(std::string_view name) override;
+        void on_text(std::string_view chunk) override;
+
+        bool empty() const { return content.text.empty() && rest.text.empty(); }
+        // Main content if the page had any, otherwise everything not skipped
+        std::string take();
+    };
+
+    // Decodes character references (&amp; &#39; &#x2014; ...) into UTF-8
+    void decode_entities(std::string_view in, std::string& out);
+    // Appends the UTF-8 encoding of a code point
+    void append_utf8(std::string& out, uint32_t cp);
+}
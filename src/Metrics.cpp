@@ -0,0 +1,282 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <thread>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Helpers.h"
+
+namespace lira
+{
+    namespace {
+        constexpr uint64_t METRICS_MAGIC = 0x5352544d4152494cull; // "LIRAMTRS"
+        constexpr uint32_t METRICS_VERSION = 1;
+
+        // Fixed capacity so new counters don't change the file layout
+        constexpr size_t COUNTER_SLOTS = 8;
+        constexpr size_t HISTOGRAM_SLOTS = 8;
+        static_assert(Metrics::NUM_COUNTERS <= COUNTER_SLOTS && Metrics::NUM_HISTOGRAMS <= HISTOGRAM_SLOTS);
+
+        enum SlotState : uint64_t { FREE, CLAIMING, READY };
+
+        template<class T>
+        std::atomic_ref<T> atomic(T& v) { return std::atomic_ref<T>(v); }
+
+        struct HistogramData {
+            uint64_t count, sum, max, reserved;
+            uint64_t buckets[Metrics::BUCKETS];
+        };
+    }
+
+    struct Metrics::Slot {
+        uint64_t state;
+        char name[120];
+        uint64_t counters[COUNTER_SLOTS];
+        HistogramData histograms[HISTOGRAM_SLOTS];
+    };
+
+    struct Metrics::File {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t reserved[13];
+        Slot slots[MAX_MODELS];
+    };
+
+    // --- Buckets ---
+    size_t Metrics::bucket_of(uint64_t value) {
+        constexpr uint64_t SUB = 1ull << SUB_BITS;
+        if (value < SUB) return static_cast<size_t>(value);
+        const unsigned msb = 63 - std::countl_zero(value);
+        if (msb >= MAX_BITS) return BUCKETS - 1;
+        const unsigned shift = msb - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + ((value >> shift) & (SUB - 1));
+    }
+
+    uint64_t Metrics::bucket_low(size_t bucket) {
+        constexpr uint64_t SUB = 1ull << SUB_BITS;
+        if (bucket < SUB) return bucket;
+        const unsigned shift = static_cast<unsigned>(bucket >> SUB_BITS) - 1;
+        return (SUB + (bucket & (SUB - 1))) << shift;
+    }
+
+    uint64_t Metrics::bucket_high(size_t bucket) {
+        return bucket + 1 < BUCKETS ? bucket_low(bucket + 1) - 1 : UINT64_MAX;
+    }
+
+    double Metrics::HistogramStats::percentile(double p) const {
+        if (!count) return 0.0;
+        const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * static_cast<double>(count))));
+        uint64_t seen = 0;
+        for (size_t b = 0; b < buckets.size(); ++b) {
+            seen += buckets[b];
+            if (seen < rank) continue;
+            const uint64_t low = bucket_low(b);
+            const uint64_t high = std::min(bucket_high(b), max);
+            return std::min<double>(low + (high - low) / 2.0, static_cast<double>(max));
+        }
+        return static_cast<double>(max);
+    }
+
+    // --- Recording ---
+    void Metrics::Model::add(Counter c, uint64_t n) const {
+        if (slot) atomic(slot->counters[c]).fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void Metrics::Model::record(Histogram h, uint64_t value) const {
+        if (!slot) return;
+        HistogramData& d = slot->histograms[h];
+        atomic(d.buckets[bucket_of(value)]).fetch_add(1, std::memory_order_relaxed);
+        atomic(d.count).fetch_add(1, std::memory_order_relaxed);
+        atomic(d.sum).fetch_add(value, std::memory_order_relaxed);
+        auto max = atomic(d.max);
+        uint64_t cur = max.load(std::memory_order_relaxed);
+        while (value > cur && !max.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+    }
+
+    // --- Lifecycle ---
+    Metrics::Metrics(std::string path) {
+        if (path.empty()) return;
+        std::error_code ec;
+        fs::create_directories(fs::path(path).parent_path(), ec);
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) return;
+
+        // Only creation and format upgrades are serialized; recording never locks
+        flock(fd, LOCK_EX);
+        struct stat st{};
+        if (fstat(fd, &st) == 0 && (static_cast<size_t>(st.st_size) >= sizeof(File) || ftruncate(fd, sizeof(File)) == 0)) {
+            void* p = mmap(nullptr, sizeof(File), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                file = static_cast<File*>(p);
+                if (file->magic != METRICS_MAGIC || file->version != METRICS_VERSION) {
+                    // New file, or one from an older layout: start over
+                    std::memset(static_cast<void*>(file), 0, sizeof(File));
+                    file->version = METRICS_VERSION;
+                    atomic(file->magic).store(METRICS_MAGIC, std::memory_order_release);
+                }
+            }
+        }
+        flock(fd, LOCK_UN);
+        ::close(fd);
+    }
+
+    Metrics::~Metrics() {
+        if (file) munmap(file, sizeof(File));
+    }
+
+    std::shared_ptr<Metrics> Metrics::shared() {
+        static std::shared_ptr<Metrics> instance =
+            std::make_shared<Metrics>(get_metrics_enabled() ? METRICS_DB : std::string());
+        return instance;
+    }
+
+    Metrics::Model Metrics::model(std::string_view name) {
+        if (!file) return {};
+        name = name.substr(0, sizeof(Slot::name) - 1);
+        for (Slot& s : file->slots) {
+            auto state = atomic(s.state);
+            uint64_t st = state.load(std::memory_order_acquire);
+            if (st == FREE) {
+                if (state.compare_exchange_strong(st, CLAIMING, std::memory_order_acquire)) {
+                    std::memset(s.name, 0, sizeof(s.name));
+                    std::memcpy(s.name, name.data(), name.size());
+                    state.store(READY, std::memory_order_release);
+                    return Model(&s);
+                }
+            }
+            // Another process is naming this slot; a claimer that died leaves it unusable
+            for (int spin = 0; st == CLAIMING && spin < 1000; ++spin) {
+                std::this_thread::yield();
+                st = state.load(std::memory_order_acquire);
+            }
+            if (st == READY && name == std::string_view(s.name)) return Model(&s);
+        }
+        return {};
+    }
+
+    std::vector<Metrics::ModelStats> Metrics::stats() const {
+        std::vector<ModelStats> out;
+        if (!file) return out;
+        for (Slot& s : file->slots) {
+            if (atomic(s.state).load(std::memory_order_acquire) != READY) continue;
+            ModelStats m;
+            m.model = s.name;
+            for (size_t c = 0; c < NUM_COUNTERS; ++c) m.counters[c] = atomic(s.counters[c]).load(std::memory_order_relaxed);
+            for (size_t h = 0; h < NUM_HISTOGRAMS; ++h) {
+                HistogramData& d = s.histograms[h];
+                HistogramStats& hs = m.histograms[h];
+                hs.count = atomic(d.count).load(std::memory_order_relaxed);
+                if (!hs.count) continue;
+                hs.sum = atomic(d.sum).load(std::memory_order_relaxed);
+                hs.max = atomic(d.max).load(std::memory_order_relaxed);
+                hs.buckets.resize(BUCKETS);
+                for (size_t b = 0; b < BUCKETS; ++b) hs.buckets[b] = atomic(d.buckets[b]).load(std::memory_order_relaxed);
+            }
+            out.push_back(std::move(m));
+        }
+        return out;
+    }
+
+    // --- Reporting ---
+    const char* Metrics::counter_name(Counter c) {
+        switch (c) {
+            case TURNS: return "turns";
+            case REQUESTS: return "requests";
+            case FAILED_REQUESTS: return "failed_requests";
+            case TOKENS: return "tokens";
+            case TOOL_CALLS: return "tool_calls";
+            default: return "?";
+        }
+    }
+
+    const char* Metrics::histogram_name(Histogram h) {
+        switch (h) {
+            case TTFT_US: return "ttft";
+            case TOKEN_GAP_US: return "token_gap";
+            case TOKENS_PER_S: return "tokens_per_s";
+            case REQUEST_BYTES: return "request_bytes";
+            case REQUEST_US: return "request";
+            case TOOL_US: return "tool";
+            case TURN_US: return "turn";
+            default: return "?";
+        }
+    }
+
+    double Metrics::histogram_scale(Histogram h) {
+        switch (h) {
+            case TOKENS_PER_S: return 100.0;
+            case REQUEST_BYTES: return 1.0;
+            default: return 1000.0;  // microseconds shown as milliseconds
+        }
+    }
+
+    const char* Metrics::histogram_unit(Histogram h) {
+        switch (h) {
+            case TOKENS_PER_S: return "tok/s";
+            case REQUEST_BYTES: return "bytes";
+            default: return "ms";
+        }
+    }
+
+    std::string Metrics::format(const std::vector<ModelStats>& stats) {
+        if (stats.empty()) return "No metrics recorded yet.\n";
+        std::string out;
+        for (const auto& m : stats) {
+            out += std::format("{}{}{}\n ", ANSI_CYAN, m.model, ANSI_RESET);
+            for (size_t c = 0; c < NUM_COUNTERS; ++c) out += std::format(" {} {}", counter_name(static_cast<Counter>(c)), m.counters[c]);
+            out += std::format("\n  {}{:<22} {:>8} {:>10} {:>10} {:>10} {:>10} {:>10}{}\n",
+                ANSI_GRAY, "", "count", "p50", "p90", "p99", "max", "mean", ANSI_RESET);
+            for (size_t h = 0; h < NUM_HISTOGRAMS; ++h) {
+                const auto& hs = m.histograms[h];
+                if (!hs.count) continue;
+                const auto id = static_cast<Histogram>(h);
+                const double scale = histogram_scale(id);
+                out += std::format("  {:<22} {:>8} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f}\n",
+                    std::format("{} ({})", histogram_name(id), histogram_unit(id)), hs.count,
+                    hs.percentile(0.5) / scale, hs.percentile(0.9) / scale, hs.percentile(0.99) / scale,
+                    hs.max / scale, hs.mean() / scale);
+            }
+        }
+        return out;
+    }
+
+    json Metrics::to_json(const std::vector<ModelStats>& stats) {
+        json models = json::array();
+        for (const auto& m : stats) {
+            json counters = json::object();
+            for (size_t c = 0; c < NUM_COUNTERS; ++c) counters[counter_name(static_cast<Counter>(c))] = m.counters[c];
+            json histograms = json::object();
+            for (size_t h = 0; h < NUM_HISTOGRAMS; ++h) {
+                const auto& hs = m.histograms[h];
+                const auto id = static_cast<Histogram>(h);
+                const double scale = histogram_scale(id);
+                // Non-empty buckets as [low, high, count] in display units
+                json buckets = json::array();
+                for (size_t b = 0; b < hs.buckets.size(); ++b) {
+                    if (hs.buckets[b]) buckets.push_back({bucket_low(b) / scale, std::min(bucket_high(b), hs.max) / scale, hs.buckets[b]});
+                }
+                histograms[histogram_name(id)] = {
+                    {"unit", histogram_unit(id)},
+                    {"count", hs.count},
+                    {"mean", hs.mean() / scale},
+                    {"max", hs.max / scale},
+                    {"p50", hs.percentile(0.5) / scale},
+                    {"p90", hs.percentile(0.9) / scale},
+                    {"p99", hs.percentile(0.99) / scale},
+                    {"buckets", std::move(buckets)},
+                };
+            }
+            models.push_back({{"model", m.model}, {"counters", std::move(counters)}, {"histograms", std::move(histograms)}});
+        }
+        return {{"models", std::move(models)}};
+    }
+}
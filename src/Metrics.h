@@ -0,0 +1,110 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json_fwd.hpp>
+
+namespace lira
+{
+    // Usage metrics per model, shared by all lira processes and kept across
+    // runs. Counters and log-bucketed histograms live in one mmapped file
+    // (METRICS_DB) and are updated with relaxed atomic adds, so recording
+    // never takes a lock and is cheap enough for every streamed token.
+    class Metrics {
+        struct Slot;  // one model's counters and histograms in the file
+        struct File;
+
+    public:
+        enum Counter : size_t {
+            TURNS,
+            REQUESTS,
+            FAILED_REQUESTS,   // curl error or HTTP status >= 400
+            TOKENS,            // streamed content deltas
+            TOOL_CALLS,
+            NUM_COUNTERS
+        };
+
+        enum Histogram : size_t {
+            TTFT_US,           // request start to first content delta
+            TOKEN_GAP_US,      // between consecutive deltas
+            TOKENS_PER_S,      // x100, per request
+            REQUEST_BYTES,     // serialized payload
+            REQUEST_US,        // whole streamed request
+            TOOL_US,           // one tool execution
+            TURN_US,           // Agent::process
+            NUM_HISTOGRAMS
+        };
+
+        // HDR-style buckets: exact below 16, then 16 per power of two (<= 6.25% error)
+        static constexpr unsigned SUB_BITS = 4;
+        static constexpr unsigned MAX_BITS = 40;  // larger values land in the last bucket
+        static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+        static constexpr size_t MAX_MODELS = 32;
+
+        static size_t bucket_of(uint64_t value);
+        static uint64_t bucket_low(size_t bucket);   // smallest value in the bucket
+        static uint64_t bucket_high(size_t bucket);  // largest value in the bucket
+
+        // Recording handle for one model; a default one (metrics disabled or
+        // no free slot) ignores everything
+        class Model {
+        public:
+            Model() = default;
+            void add(Counter c, uint64_t n = 1) const;
+            void record(Histogram h, uint64_t value) const;
+            explicit operator bool() const { return slot != nullptr; }
+
+        private:
+            friend class Metrics;
+            Slot* slot = nullptr;
+            explicit Model(Slot* s) : slot(s) {}
+        };
+
+        struct HistogramStats {
+            uint64_t count = 0;
+            uint64_t sum = 0;
+            uint64_t max = 0;
+            std::vector<uint64_t> buckets;  // BUCKETS entries, or empty when count is 0
+
+            double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+            // Midpoint of the bucket holding the p-th value (p in [0, 1]), capped at max
+            double percentile(double p) const;
+        };
+
+        struct ModelStats {
+            std::string model;
+            std::array<uint64_t, NUM_COUNTERS> counters{};
+            std::array<HistogramStats, NUM_HISTOGRAMS> histograms{};
+        };
+
+        explicit Metrics(std::string path);
+        ~Metrics();
+        Metrics(const Metrics&) = delete;
+        Metrics& operator=(const Metrics&) = delete;
+
+        static std::shared_ptr<Metrics> shared();
+
+        // Finds or claims the slot for `name`
+        Model model(std::string_view name);
+
+        std::vector<ModelStats> stats() const;
+        bool enabled() const { return file != nullptr; }
+
+        static const char* counter_name(Counter c);
+        static const char* histogram_name(Histogram h);
+        // Divisor turning stored values into display units (us -> ms, x100 -> tok/s)
+        static double histogram_scale(Histogram h);
+        static const char* histogram_unit(Histogram h);
+
+        // Percentile table for `lira --stats`
+        static std::string format(const std::vector<ModelStats>& stats);
+        // Counters, percentiles and raw buckets for dashboards (`lira --stats-json`)
+        static nlohmann::json to_json(const std::vector<ModelStats>& stats);
+
+    private:
+        File* file = nullptr;  // mmapped METRICS_DB
+    };
+}
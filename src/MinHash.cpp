@@ -0,0 +1,120 @@
+#include "MinHash.h"
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+namespace lira
+{
+    // --- Hashing Helpers ---
+    static uint64_t splitmix64(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    static uint64_t fnv1a(const char* data, size_t len) {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        for (size_t i = 0; i < len; ++i) {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 0x100000001B3ULL;
+        }
+        return h;
+    }
+
+    // Lowercase alphanumerics, everything else collapses into single spaces,
+    // so "User's editor: Vim!" and "users editor vim" shingle the same way.
+    static std::string normalize(const std::string& text) {
+        std::string out;
+        out.reserve(text.size());
+        bool pending_space = false;
+        for (unsigned char c : text) {
+            if (std::isalnum(c) || c >= 0x80) {
+                if (pending_space && !out.empty()) out += ' ';
+                pending_space = false;
+                out += static_cast<char>(std::tolower(c));
+            } else if (c != '\'') {
+                pending_space = true;
+            }
+        }
+        return out;
+    }
+
+    // --- Signatures ---
+    MinHashIndex::Signature MinHashIndex::signature(const std::string& text) {
+        Signature sig;
+        sig.fill(std::numeric_limits<uint32_t>::max());
+
+        const std::string norm = normalize(text);
+        constexpr size_t K = 3;
+        const size_t shingles = norm.size() >= K ? norm.size() - K + 1 : (norm.empty() ? 0 : 1);
+
+        for (size_t s = 0; s < shingles; ++s) {
+            const uint64_t base = fnv1a(norm.data() + s, std::min(K, norm.size()));
+            for (size_t i = 0; i < NUM_HASHES; ++i) {
+                const auto h = static_cast<uint32_t>(splitmix64(base ^ (i * 0xA24BAED4963EE407ULL)));
+                if (h < sig[i]) sig[i] = h;
+            }
+        }
+        return sig;
+    }
+
+    double MinHashIndex::similarity(const Signature& a, const Signature& b) {
+        size_t equal = 0;
+        for (size_t i = 0; i < NUM_HASHES; ++i) if (a[i] == b[i]) equal++;
+        return static_cast<double>(equal) / NUM_HASHES;
+    }
+
+    uint64_t MinHashIndex::band_key(const Signature& sig, size_t band) {
+        uint64_t h = band;
+        for (size_t r = 0; r < ROWS; ++r) h = splitmix64(h ^ sig[band * ROWS + r]);
+        return h;
+    }
+
+    // --- Index Maintenance ---
+    void MinHashIndex::insert(size_t id, const Signature& sig) {
+        erase(id);
+        for (size_t b = 0; b < BANDS; ++b) buckets[b][band_key(sig, b)].push_back(id);
+        signatures[id] = sig;
+    }
+
+    void MinHashIndex::erase(size_t id) {
+        auto it = signatures.find(id);
+        if (it == signatures.end()) return;
+        for (size_t b = 0; b < BANDS; ++b) {
+            auto bucket = buckets[b].find(band_key(it->second, b));
+            if (bucket == buckets[b].end()) continue;
+            std::erase(bucket->second, id);
+            if (bucket->second.empty()) buckets[b].erase(bucket);
+        }
+        signatures.erase(it);
+    }
+
+    void MinHashIndex::clear() {
+        for (auto& band : buckets) band.clear();
+        signatures.clear();
+    }
+
+    // --- Queries ---
+    std::vector<size_t> MinHashIndex::candidates(const Signature& sig) const {
+        std::vector<size_t> out;
+        for (size_t b = 0; b < BANDS; ++b) {
+            auto bucket = buckets[b].find(band_key(sig, b));
+            if (bucket == buckets[b].end()) continue;
+            out.insert(out.end(), bucket->second.begin(), bucket->second.end());
+        }
+        std::ranges::sort(out);
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out;
+    }
+
+    long MinHashIndex::find_similar(const Signature& sig, double threshold) const {
+        long best = -1;
+        double best_score = threshold;
+        for (size_t id : candidates(sig)) {
+            const double score = similarity(sig, signatures.at(id));
+            if (score >= best_score) { best = static_cast<long>(id); best_score = score; }
+        }
+        return best;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lira
+{
+    // MinHash signatures over character trigrams, indexed with LSH banding.
+    // Two texts only become candidates if at least one band of their
+    // signatures matches exactly, so lookups don't scan the whole store.
+    class MinHashIndex {
+    public:
+        static constexpr size_t NUM_HASHES = 64;
+        static constexpr size_t BANDS = 16;
+        static constexpr size_t ROWS = NUM_HASHES / BANDS; // 4 rows per band
+        using Signature = std::array<uint32_t, NUM_HASHES>;
+
+        static Signature signature(const std::string& text);
+        // Estimated Jaccard similarity of the underlying shingle sets
+        static double similarity(const Signature& a, const Signature& b);
+
+        void insert(size_t id, const Signature& sig);
+        void erase(size_t id);
+        void clear();
+
+        // Ids sharing at least one band with `sig` (unordered, deduplicated)
+        std::vector<size_t> candidates(const Signature& sig) const;
+        // Best candidate with similarity >= threshold, or -1
+        long find_similar(const Signature& sig, double threshold) const;
+
+    private:
+        std::array<std::unordered_map<uint64_t, std::vector<size_t>>, BANDS> buckets;
+        std::unordered_map<size_t, Signature> signatures;
+
+        static uint64_t band_key(const Signature& sig, size_t band);
+    };
+}
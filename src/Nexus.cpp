@@ -4,32 +4,409 @@
 
 #include "Nexus.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "Helpers.h"
 
 namespace lira
 {
-    Nexus::Nexus() {
-        if (std::filesystem::exists(NEXUS_FILE)) {
-            std::ifstream f(NEXUS_FILE);
-            try { memories = json::parse(f); } catch(...) { memories = json::array(); }
-        } else { memories = json::array(); }
-    }
-    void Nexus::save() const
-    {
-        fs::create_directories(fs::path(NEXUS_FILE).parent_path());
-        std::ofstream o(NEXUS_FILE);
-        o << memories.dump(4);
+    // --- On-Disk Layout ---
+    // [Header][Record][Record]...  Records are 8-byte aligned and never modified
+    // once published, so readers can parse them without holding any lock.
+    namespace {
+        constexpr uint32_t NEXUS_MAGIC = 0x53584E4C; // "LNXS"
+        constexpr uint32_t NEXUS_VERSION = 1;
+        constexpr size_t HEADER_SIZE = 64;
+        constexpr size_t INITIAL_CAPACITY = 64 * 1024;
+
+        enum RecordOp : uint32_t { OP_ADD = 1, OP_SET = 2 };
+
+        struct Header {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t seq;         // seqlock: odd while a writer updates the fields below
+            uint64_t committed;   // bytes of published records after the header
+            uint64_t generation;  // bumped on every publish
+            uint64_t superseded;  // set once compaction replaced this file
+        };
+        static_assert(sizeof(Header) <= HEADER_SIZE);
+
+        struct RecordHeader {
+            uint32_t op;
+            uint32_t len;   // payload bytes
+            uint64_t slot;  // target entry for OP_SET
+        };
+
+        size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+        struct HeaderView { uint64_t committed, generation, superseded; };
+
+        // A publish takes microseconds; a seq that stays odd much longer than
+        // this belongs to a writer that died mid-publish
+        constexpr int SEQ_SPINS = 128;
+        constexpr auto SEQ_PATIENCE = std::chrono::milliseconds(50);
+
+        // False if the header stayed mid-publish past SEQ_PATIENCE
+        bool read_header(const char* map, HeaderView& out) {
+            auto* h = const_cast<Header*>(reinterpret_cast<const Header*>(map));
+            std::atomic_ref<uint64_t> seq(h->seq);
+            std::chrono::steady_clock::time_point deadline;
+            for (int spin = 0;; ++spin) {
+                const uint64_t s1 = seq.load(std::memory_order_acquire);
+                if (!(s1 & 1)) {
+                    out = {
+                        std::atomic_ref<uint64_t>(h->committed).load(std::memory_order_relaxed),
+                        std::atomic_ref<uint64_t>(h->generation).load(std::memory_order_relaxed),
+                        std::atomic_ref<uint64_t>(h->superseded).load(std::memory_order_relaxed)
+                    };
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (seq.load(std::memory_order_relaxed) == s1) return true;
+                    continue;
+                }
+                if (spin < SEQ_SPINS) continue;
+                if (spin == SEQ_SPINS) deadline = std::chrono::steady_clock::now() + SEQ_PATIENCE;
+                else if (std::chrono::steady_clock::now() > deadline) return false;
+                std::this_thread::yield();
+            }
+        }
+
+        // Closes a publish left open by a dead writer. Only safe under the
+        // writer lock: a live writer in another process looks the same.
+        void repair_header(char* map) {
+            std::atomic_ref<uint64_t> seq(reinterpret_cast<Header*>(map)->seq);
+            if (seq.load(std::memory_order_acquire) & 1) seq.fetch_add(1, std::memory_order_release);
+        }
+
+        // Header read by a writer-lock holder, repairing it if needed
+        HeaderView writer_header(char* map) {
+            HeaderView hv{};
+            if (!read_header(map, hv)) {
+                repair_header(map);
+                read_header(map, hv);
+            }
+            return hv;
+        }
+
+        // Caller holds the writer lock
+        void publish_header(char* map, uint64_t committed, uint64_t generation, uint64_t superseded) {
+            auto* h = reinterpret_cast<Header*>(map);
+            std::atomic_ref<uint64_t> seq(h->seq);
+            const uint64_t s = seq.load(std::memory_order_relaxed);
+            seq.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::atomic_ref<uint64_t>(h->committed).store(committed, std::memory_order_relaxed);
+            std::atomic_ref<uint64_t>(h->generation).store(generation, std::memory_order_relaxed);
+            std::atomic_ref<uint64_t>(h->superseded).store(superseded, std::memory_order_relaxed);
+            seq.store(s + 2, std::memory_order_release);
+        }
+
+        // Serializes writers across threads (mutex) and processes (flock)
+        struct WriterLock {
+            std::lock_guard<std::mutex> guard;
+            int fd;
+            WriterLock(std::mutex& m, int f) : guard(m), fd(f) { if (fd >= 0) flock(fd, LOCK_EX); }
+            ~WriterLock() { if (fd >= 0) flock(fd, LOCK_UN); }
+        };
+
+        bool write_all(int fd, const char* data, size_t len) {
+            while (len > 0) {
+                ssize_t n = ::write(fd, data, len);
+                if (n <= 0) return false;
+                data += n; len -= static_cast<size_t>(n);
+            }
+            return true;
+        }
+    }
+
+    // --- Lifecycle ---
+    Nexus::Nexus() : Nexus(NEXUS_DB) {}
+
+    Nexus::Nexus(std::string path) : db_path(std::move(path)), dedup_threshold(get_nexus_dedup_threshold()) {
+        fs::create_directories(fs::path(db_path).parent_path());
+        lock_fd = ::open((db_path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        {
+            WriterLock lock(writer_mtx, lock_fd);
+            if (!open_db()) {
+                std::cerr << "[Nexus] Failed to open " << db_path << ", memories will not persist." << std::endl;
+                return;
+            }
+            if (writer_header(map).generation == 0 && db_path == NEXUS_DB) import_legacy_json();
+        }
+        refresh();
+    }
+
+    Nexus::~Nexus() {
+        close_db();
+        if (lock_fd >= 0) ::close(lock_fd);
+    }
+
+    std::shared_ptr<Nexus> Nexus::shared() {
+        static std::mutex m;
+        static std::weak_ptr<Nexus> instance;
+        std::lock_guard lock(m);
+        auto p = instance.lock();
+        if (!p) { p = std::make_shared<Nexus>(); instance = p; }
+        return p;
+    }
+
+    // Opens (and if needed initializes) the log. Caller holds the writer lock,
+    // except when reopening after compaction, where the file is already complete.
+    // A publish left open by a dead writer is repaired by the next writer.
+    bool Nexus::open_db() {
+        db_fd = ::open(db_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (db_fd < 0) return false;
+
+        struct stat st{};
+        if (fstat(db_fd, &st) != 0) { close_db(); return false; }
+        if (static_cast<size_t>(st.st_size) < HEADER_SIZE) {
+            if (ftruncate(db_fd, INITIAL_CAPACITY) != 0) { close_db(); return false; }
+            Header h{NEXUS_MAGIC, NEXUS_VERSION, 0, 0, 0, 0};
+            if (pwrite(db_fd, &h, sizeof(h), 0) != static_cast<ssize_t>(sizeof(h))) { close_db(); return false; }
+        }
+        if (!remap(0)) { close_db(); return false; }
+
+        auto* h = reinterpret_cast<Header*>(map);
+        if (h->magic != NEXUS_MAGIC || h->version != NEXUS_VERSION) { close_db(); return false; }
+        return true;
+    }
+
+    void Nexus::close_db() {
+        if (map) munmap(map, map_size);
+        map = nullptr; map_size = 0;
+        if (db_fd >= 0) ::close(db_fd);
+        db_fd = -1;
     }
+
+    // Maps the whole file, growing it first if a writer needs `min_size` bytes
+    bool Nexus::remap(size_t min_size) {
+        struct stat st{};
+        if (fstat(db_fd, &st) != 0) return false;
+        size_t size = static_cast<size_t>(st.st_size);
+        if (size < min_size) {
+            size = std::max(min_size, size * 2);
+            if (ftruncate(db_fd, static_cast<off_t>(size)) != 0) return false;
+        }
+        if (map && size == map_size) return true;
+        if (map) munmap(map, map_size);
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, db_fd, 0);
+        if (p == MAP_FAILED) { map = nullptr; map_size = 0; return false; }
+        map = static_cast<char*>(p);
+        map_size = size;
+        return true;
+    }
+
+    // One-time migration from the old nexus.json array. Caller holds the writer lock.
+    void Nexus::import_legacy_json() {
+        if (!fs::exists(NEXUS_FILE)) return;
+        json legacy;
+        std::ifstream f(NEXUS_FILE);
+        try { legacy = json::parse(f); } catch(...) { return; }
+        if (!legacy.is_array()) return;
+        for (const auto& m : legacy) {
+            if (!m.is_string()) continue;
+            const auto text = m.get<std::string>();
+            if (index.find_similar(MinHashIndex::signature(text), dedup_threshold) < 0) {
+                append_record(OP_ADD, 0, text);
+                apply_new_records();
+            }
+        }
+    }
+
+    // --- Log Replay ---
+    void Nexus::reload_locked() {
+        entries.clear();
+        index.clear();
+        read_offset = 0;
+        seen_generation = 0;
+    }
+
+    // Applies records in [read_offset, committed). Caller holds mtx exclusively.
+    void Nexus::apply_new_records() {
+        HeaderView hv{};
+        if (!read_header(map, hv)) return; // picked up once a writer repairs the header
+        if (HEADER_SIZE + hv.committed > map_size && !remap(0)) return;
+        // A truncated file must not be read past its end either
+        const uint64_t end = std::min<uint64_t>(hv.committed, map_size - HEADER_SIZE);
+
+        while (read_offset < hv.committed) {
+            RecordHeader rh{};
+            const bool framed = read_offset + sizeof(rh) <= end;
+            if (framed) std::memcpy(&rh, map + HEADER_SIZE + read_offset, sizeof(rh));
+            if (!framed || rh.len > end - read_offset - sizeof(rh)) {
+                // Torn or corrupt record: nothing after it can be framed. Skip
+                // to the end; our next write rewrites the log without it.
+                std::cerr << "[Nexus] Corrupt record at offset " << read_offset << " in " << db_path
+                          << ", skipping " << hv.committed - read_offset << " bytes" << std::endl;
+                read_offset = hv.committed;
+                corrupt = true;
+                break;
+            }
+            const char* payload = map + HEADER_SIZE + read_offset + sizeof(rh);
+            read_offset += align8(sizeof(rh) + rh.len);
+
+            if (rh.op == OP_SET && rh.slot < entries.size()) {
+                std::string text(payload, rh.len);
+                index.insert(rh.slot, MinHashIndex::signature(text));
+                entries[rh.slot] = std::move(text);
+            } else if (rh.op == OP_ADD) {
+                std::string text(payload, rh.len);
+                index.insert(entries.size(), MinHashIndex::signature(text));
+                entries.push_back(std::move(text));
+            }
+        }
+        seen_generation = hv.generation;
+    }
+
+    // Caller holds the writer lock and mtx exclusively, and has applied all records
+    bool Nexus::append_record(uint32_t op, uint64_t slot, const std::string& text) {
+        const size_t rec_size = align8(sizeof(RecordHeader) + text.size());
+        const HeaderView hv = writer_header(map);
+        if (!remap(HEADER_SIZE + hv.committed + rec_size)) {
+            std::cerr << "[Nexus] Cannot grow " << db_path << ", memory not saved: " << text << std::endl;
+            return false;
+        }
+
+        RecordHeader rh{op, static_cast<uint32_t>(text.size()), slot};
+        char* dst = map + HEADER_SIZE + hv.committed;
+        std::memcpy(dst, &rh, sizeof(rh));
+        std::memcpy(dst + sizeof(rh), text.data(), text.size());
+        publish_header(map, hv.committed + rec_size, hv.generation + 1, 0);
+        return true;
+    }
+
+    void Nexus::refresh() { sync(false); }
+
+    void Nexus::sync(bool writer_held) {
+        HeaderView hv{};
+        bool readable;
+        {
+            std::shared_lock lock(mtx);
+            if (!map) return;
+            readable = read_header(map, hv);
+            if (readable && !hv.superseded && hv.generation == seen_generation.load() && !(writer_held && corrupt)) return;
+        }
+        if (!readable) {
+            // Stuck mid-publish: once we hold the writer lock no live writer
+            // can be publishing, so an odd seq is safe to close
+            std::optional<WriterLock> wl;
+            if (!writer_held) wl.emplace(writer_mtx, lock_fd);
+            std::shared_lock lock(mtx);
+            if (!map) return;
+            repair_header(map);
+        }
+
+        std::unique_lock lock(mtx);
+        if (!map) return;
+        if (!read_header(map, hv)) return;
+        if (hv.superseded) {
+            // Compaction swapped the file underneath us: reopen and replay from scratch
+            close_db();
+            if (!open_db()) return;
+            reload_locked();
+        }
+        apply_new_records();
+        if (writer_held && corrupt) rewrite_locked(entries);
+    }
+
+    // --- Public API ---
     void Nexus::add_memory(const std::string& content) {
-        for (const auto& m : memories) if (m.get<std::string>() == content) return;
-        memories.push_back(content);
-        save();
+        trace::Span span("nexus", "add_memory");
+        WriterLock wl(writer_mtx, lock_fd);
+        sync(true);
+
+        std::unique_lock lock(mtx);
+        if (!map) return;
+        const auto sig = MinHashIndex::signature(content);
+        if (long dup = index.find_similar(sig, dedup_threshold); dup >= 0) {
+            // Newer phrasing wins: facts get refined or updated over time
+            if (entries[dup] == content) return;
+            append_record(OP_SET, static_cast<uint64_t>(dup), content);
+        } else {
+            append_record(OP_ADD, 0, content);
+        }
+        apply_new_records();
+    }
+
+    size_t Nexus::compact() {
+        trace::Span span("nexus", "compact");
+        WriterLock wl(writer_mtx, lock_fd);
+        sync(true);
+
+        std::unique_lock lock(mtx);
+        if (!map) return 0;
+        std::vector<std::string> kept;
+        MinHashIndex fresh;
+        for (const auto& e : entries) {
+            const auto sig = MinHashIndex::signature(e);
+            if (long dup = fresh.find_similar(sig, dedup_threshold); dup >= 0) {
+                kept[dup] = e;
+                fresh.insert(static_cast<size_t>(dup), sig);
+            } else {
+                fresh.insert(kept.size(), sig);
+                kept.push_back(e);
+            }
+        }
+        const size_t removed = entries.size() - kept.size();
+        if (removed == 0) return 0;
+        return rewrite_locked(std::move(kept)) ? removed : 0;
     }
+
+    // Replaces the log with one ADD record per entry and reloads from it.
+    // Caller holds the writer lock and mtx exclusively.
+    bool Nexus::rewrite_locked(std::vector<std::string> kept) {
+        // Write the new log next to the old one and swap it in atomically
+        std::string body;
+        for (const auto& e : kept) {
+            RecordHeader rh{OP_ADD, static_cast<uint32_t>(e.size()), 0};
+            body.append(reinterpret_cast<const char*>(&rh), sizeof(rh));
+            body += e;
+            body.resize(align8(body.size()), '\0');
+        }
+        const std::string tmp_path = db_path + ".tmp";
+        int tmp_fd = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (tmp_fd < 0) return false;
+        Header h{NEXUS_MAGIC, NEXUS_VERSION, 0, body.size(), 1, 0};
+        std::string head(HEADER_SIZE, '\0');
+        std::memcpy(head.data(), &h, sizeof(h));
+        bool ok = write_all(tmp_fd, head.data(), head.size()) && write_all(tmp_fd, body.data(), body.size()) && fsync(tmp_fd) == 0;
+        ::close(tmp_fd);
+        if (!ok || std::rename(tmp_path.c_str(), db_path.c_str()) != 0) { fs::remove(tmp_path); return false; }
+
+        // Tell readers still mapping the old file to reopen
+        const HeaderView hv = writer_header(map);
+        publish_header(map, hv.committed, hv.generation + 1, 1);
+
+        close_db();
+        reload_locked();
+        corrupt = false;
+        if (open_db()) apply_new_records();
+        return true;
+    }
+
+    size_t Nexus::size() const {
+        std::shared_lock lock(mtx);
+        return entries.size();
+    }
+
     std::string Nexus::retrieve_relevant(const std::string& query) {
-        if (memories.empty()) return "No memories yet.";
+        trace::Span span("nexus", "retrieve_relevant");
+        refresh();
+        std::shared_lock lock(mtx);
+        span.arg("entries", static_cast<double>(entries.size()));
+        if (entries.empty()) return "No memories yet.";
         std::set<std::string> query_tokens;
         std::stringstream ss(query);
         std::string word;
@@ -38,8 +415,7 @@ namespace lira
             if(word.length() > 3) query_tokens.insert(word);
         }
         std::vector<std::pair<int, std::string>> ranked;
-        for (const auto& item : memories) {
-            auto mem_str = item.get<std::string>();
+        for (const auto& mem_str : entries) {
             int score = 0;
             for (const auto& token : query_tokens) if (mem_str.find(token) != std::string::npos) score++;
             if (score > 0) ranked.emplace_back(score, mem_str);
@@ -3,17 +3,66 @@
 //
 
 #pragma once
-#include <nlohmann/json.hpp>
-#include <nlohmann/json_fwd.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "MinHash.h"
 
 namespace lira
 {
+    // Memory store shared between all lira processes.
+    // Backed by an append-only log (NEXUS_DB) that every process mmaps. Readers
+    // never lock: they check a seqlock-protected header and only parse records
+    // appended since their last look. Writers serialize on a lock file and
+    // publish new records by bumping the header's generation.
     class Nexus {
-        nlohmann::json memories;
+        std::string db_path;
+        int db_fd = -1;
+        int lock_fd = -1;
+        char* map = nullptr;
+        size_t map_size = 0;
+        uint64_t read_offset = 0;                // log bytes already applied
+        std::atomic<uint64_t> seen_generation{0};
+        bool corrupt = false;                    // skipped an unframeable record; next write rewrites the log
+
+        std::vector<std::string> entries;
+        MinHashIndex index;
+        double dedup_threshold;
+        mutable std::shared_mutex mtx;          // guards the in-memory view and the mapping
+        std::mutex writer_mtx;                  // in-process half of the writer lock
+
+        bool open_db();
+        void close_db();
+        bool remap(size_t min_size);
+        void import_legacy_json();
+        void reload_locked();
+        void apply_new_records();
+        bool append_record(uint32_t op, uint64_t slot, const std::string& text);
+        bool rewrite_locked(std::vector<std::string> kept);
+        // refresh(); `writer_held` when the caller already has the writer lock
+        void sync(bool writer_held);
+
     public:
         Nexus();
-        void save() const;
+        // Store at another path (benchmarks, tools); no legacy import
+        explicit Nexus(std::string path);
+        ~Nexus();
+        Nexus(const Nexus&) = delete;
+        Nexus& operator=(const Nexus&) = delete;
+
+        // One instance per process, shared by every Agent
+        static std::shared_ptr<Nexus> shared();
+
         void add_memory(const std::string& content);
         std::string retrieve_relevant(const std::string& query);
+
+        // Pull in records published by other processes. Cheap when nothing changed.
+        void refresh();
+        // Offline dedup pass over the whole store. Returns number of memories removed.
+        size_t compact();
+        size_t size() const;
     };
 }
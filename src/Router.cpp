@@ -0,0 +1,224 @@
+#include "Router.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+
+#include "Helpers.h"
+
+namespace lira
+{
+    namespace {
+        // Past this the conversation needs the strong model's context handling
+        constexpr size_t HEAVY_PROMPT_CHARS = 48000;
+        // Longest user message / tool output still considered cheap
+        constexpr size_t FAST_MESSAGE_CHARS = 280;
+        constexpr size_t FAST_FOLLOWUP_CHARS = 2000;
+
+        constexpr double HEALTH_ALPHA = 0.3;     // weight of the newest request
+        constexpr size_t HEALTH_MIN_SAMPLES = 3; // before a model can be written off
+        constexpr double MAX_ERROR_RATE = 0.5;
+        constexpr uintmax_t LOG_BYTES = 1 << 20; // then rotated to router.log.1
+
+        constexpr std::array REASONING_WORDS = {
+            "why", "explain", "design", "debug", "refactor", "implement", "architect",
+            "optimi", "compare", "analy", "review", "prove", "plan", "fix", "bug",
+        };
+
+        bool looks_like_code(std::string_view text) {
+            if (text.find("```") != std::string_view::npos) return true;
+            // Unfenced source: several lines ending like C-family statements or blocks
+            size_t lines = 0;
+            for (size_t pos = 0; pos < text.size();) {
+                size_t end = text.find('\n', pos);
+                if (end == std::string_view::npos) end = text.size();
+                std::string_view line = text.substr(pos, end - pos);
+                while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.remove_suffix(1);
+                if (!line.empty() && (line.back() == ';' || line.back() == '{' || line.back() == '}')) {
+                    if (++lines >= 3) return true;
+                }
+                pos = end + 1;
+            }
+            return false;
+        }
+
+        bool asks_for_reasoning(std::string_view text) {
+            std::string lower(text);
+            std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+            return std::any_of(REASONING_WORDS.begin(), REASONING_WORDS.end(),
+                [&](const char* w) { return lower.find(w) != std::string::npos; });
+        }
+    }
+
+    // --- Setup ---
+    ModelRouter::ModelRouter(std::string strong, std::vector<std::string> fast, std::string log_path)
+        : strong(std::move(strong)), fast(std::move(fast)), log_path(std::move(log_path)) {
+        // Start from what earlier runs measured; seeds only rank, they never exclude
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto& m : Metrics::shared()->stats()) {
+            if (std::find(this->fast.begin(), this->fast.end(), m.model) == this->fast.end()) continue;
+            const auto requests = m.counters[Metrics::REQUESTS];
+            if (!requests) continue;
+            Health& h = health[m.model];
+            h.ttft_ms = m.histograms[Metrics::TTFT_US].percentile(0.5) / 1000.0;
+            h.total_ms = m.histograms[Metrics::REQUEST_US].percentile(0.5) / 1000.0;
+            h.error_rate = static_cast<double>(m.counters[Metrics::FAILED_REQUESTS]) / static_cast<double>(requests);
+            h.updated = now;
+        }
+    }
+
+    std::shared_ptr<ModelRouter> ModelRouter::shared() {
+        static std::shared_ptr<ModelRouter> instance = std::make_shared<ModelRouter>(get_model(), get_fast_models(), ROUTER_LOG);
+        return instance;
+    }
+
+    RequestFeatures ModelRouter::features(std::string_view message, size_t prompt_chars, bool tool_followup) {
+        RequestFeatures f;
+        f.prompt_chars = prompt_chars;
+        f.message_chars = message.size();
+        f.tool_followup = tool_followup;
+        f.has_code = looks_like_code(message);
+        // Tool output says nothing about what the user asked for
+        f.reasoning = !tool_followup && asks_for_reasoning(message);
+        return f;
+    }
+
+    RequestFeatures ModelRouter::features(const turn_json& msgs, bool tool_followup) {
+        size_t prompt_chars = 0;
+        for (const auto& m : msgs) prompt_chars += m["content"].get_ref<const turn_string&>().size();
+
+        std::string message;
+        for (auto it = msgs.rbegin(); it != msgs.rend() && (*it)["role"] == "user"; ++it) {
+            const auto& content = (*it)["content"].get_ref<const turn_string&>();
+            message.insert(0, content.data(), content.size());
+            if (!tool_followup) break;
+        }
+        return features(message, prompt_chars, tool_followup);
+    }
+
+    // --- Routing ---
+    // A skipped model gets no new samples, so its errors fade with time instead
+    double ModelRouter::error_rate(const Health& h, std::chrono::steady_clock::time_point now) const {
+        if (h.error_rate == 0.0 || error_half_life.count() <= 0) return h.error_rate;
+        const double idle = std::chrono::duration<double>(now - h.updated) / std::chrono::duration<double>(error_half_life);
+        return h.error_rate * std::exp2(-idle);
+    }
+
+    bool ModelRouter::healthy(const Health& h, std::chrono::steady_clock::time_point now) const {
+        return h.samples < HEALTH_MIN_SAMPLES || error_rate(h, now) < MAX_ERROR_RATE;
+    }
+
+    Route ModelRouter::route(const RequestFeatures& f) {
+        if (!enabled()) return {strong, "strong", "no fast model"};
+
+        Route r;
+        if (f.prompt_chars > HEAVY_PROMPT_CHARS) r.reason = "large prompt";
+        else if (f.has_code) r.reason = f.tool_followup ? "code in tool output" : "code in message";
+        else if (f.reasoning) r.reason = "reasoning request";
+        else if (f.tool_followup && f.message_chars > FAST_FOLLOWUP_CHARS) r.reason = "long tool output";
+        else if (!f.tool_followup && f.message_chars > FAST_MESSAGE_CHARS) r.reason = "long message";
+        else r.tier = "fast";
+
+        double estimate = 0.0;
+        {
+            std::lock_guard lock(mtx);
+            if (r.tier == std::string_view("fast")) {
+                // Lowest expected wait, errors counted as extra latency; unseen models go first
+                const auto now = std::chrono::steady_clock::now();
+                double best = 0.0;
+                for (const auto& m : fast) {
+                    const Health& h = health[m];
+                    if (!healthy(h, now)) continue;
+                    const double score = h.ttft_ms * (1.0 + 4.0 * error_rate(h, now));
+                    if (r.model.empty() || score < best) {
+                        r.model = m;
+                        best = score;
+                        estimate = h.ttft_ms;
+                    }
+                }
+                if (r.model.empty()) {
+                    r.tier = "strong";
+                    r.reason = "fast models failing";
+                } else {
+                    r.reason = f.tool_followup ? "short tool follow-up" : "short message";
+                }
+            }
+            if (r.model.empty()) {
+                r.model = strong;
+                estimate = health[strong].ttft_ms;
+            }
+        }
+
+        if (trace::enabled()) {
+            std::string args;
+            trace::append_arg(args, "model", r.model);
+            trace::append_arg(args, "reason", r.reason);
+            trace::instant("router", "route", std::move(args));
+        }
+        log({
+            {"event", "route"},
+            {"model", r.model},
+            {"tier", r.tier},
+            {"reason", r.reason},
+            {"prompt_chars", f.prompt_chars},
+            {"message_chars", f.message_chars},
+            {"tool_followup", f.tool_followup},
+            {"has_code", f.has_code},
+            {"reasoning", f.reasoning},
+            {"expected_ttft_ms", estimate},
+        });
+        return r;
+    }
+
+    Route ModelRouter::fallback(const Route& failed) {
+        Route r{strong, "strong", failed.model + " failed"};
+        trace::instant("router", "fallback");
+        log({{"event", "fallback"}, {"from", failed.model}, {"model", r.model}});
+        return r;
+    }
+
+    void ModelRouter::observe(const std::string& model, const StreamStats& stats) {
+        const bool ok = stats.completed && stats.http_status < 400 && stats.deltas > 0;
+        {
+            std::lock_guard lock(mtx);
+            Health& h = health[model];
+            const auto now = std::chrono::steady_clock::now();
+            const double a = h.samples ? HEALTH_ALPHA : 1.0;
+            h.error_rate = error_rate(h, now);
+            h.error_rate += a * ((ok ? 0.0 : 1.0) - h.error_rate);
+            h.updated = now;
+            // Failures say nothing about speed
+            if (ok) {
+                h.ttft_ms += a * (stats.ttft_ms() - h.ttft_ms);
+                h.total_ms += a * (stats.total_ms() - h.total_ms);
+            }
+            h.samples++;
+        }
+        log({
+            {"event", "result"},
+            {"model", model},
+            {"ok", ok},
+            {"http_status", stats.http_status},
+            {"ttft_ms", stats.ttft_ms()},
+            {"total_ms", stats.total_ms()},
+        });
+    }
+
+    // --- Log ---
+    void ModelRouter::log(json line) {
+        if (log_path.empty()) return;
+        try {
+            line["t"] = std::time(nullptr);
+            std::lock_guard lock(mtx);
+            std::error_code ec;
+            if (fs::file_size(log_path, ec) > LOG_BYTES && !ec) fs::rename(log_path, log_path + ".1", ec);
+            std::ofstream out(log_path, std::ios::app);
+            out << line.dump(-1, ' ', false, json::error_handler_t::replace) << '\n';
+        } catch (...) {
+            // Routing works without its log
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json_fwd.hpp>
+#include "Arena.h"
+#include "StreamStats.h"
+
+namespace lira
+{
+    // What the router looks at in one request
+    struct RequestFeatures {
+        size_t prompt_chars = 0;    // every message sent, system prompt included
+        size_t message_chars = 0;   // the newest message
+        bool tool_followup = false; // newest message is tool output fed back to the model
+        bool has_code = false;      // newest message contains a code block or source-like lines
+        bool reasoning = false;     // newest message asks to explain, design, debug, ...
+    };
+
+    struct Route {
+        std::string model;
+        const char* tier = "strong";  // "fast" or "strong"
+        std::string reason;
+    };
+
+    // Picks the model for each request of a turn. Cheap rounds (short chat,
+    // trivial tool follow-ups) go to the fast tier (LIRA_FAST_MODELS), the
+    // rest to the strong one (LIRA_MODEL). Within the fast tier the model with
+    // the best rolling time-to-first-token wins, and models that keep failing
+    // are skipped until their error rate has decayed, then probed again.
+    // Without fast models every request goes to LIRA_MODEL.
+    //
+    // Decisions and outcomes are appended to ROUTER_LOG as JSON lines.
+    class ModelRouter {
+    public:
+        ModelRouter(std::string strong, std::vector<std::string> fast, std::string log_path);
+
+        static std::shared_ptr<ModelRouter> shared();
+
+        static RequestFeatures features(std::string_view message, size_t prompt_chars, bool tool_followup);
+        // For the next request of a conversation: the newest user message, or
+        // every tool result of the last round when following up
+        static RequestFeatures features(const turn_json& msgs, bool tool_followup);
+
+        Route route(const RequestFeatures& f);
+        // Escalation after a failed request on the fast tier
+        Route fallback(const Route& failed);
+        // Feeds one finished request into the model's rolling health
+        void observe(const std::string& model, const StreamStats& stats);
+
+        const std::string& strong_model() const { return strong; }
+        bool enabled() const { return !fast.empty(); }
+
+        // A model's error rate halves over this much time without requests,
+        // so a skipped model is tried again once it has decayed below the limit
+        std::chrono::milliseconds error_half_life = std::chrono::seconds(60);
+
+    private:
+        // Exponentially weighted, so a model that recovers is trusted again
+        struct Health {
+            double ttft_ms = 0.0;
+            double total_ms = 0.0;
+            double error_rate = 0.0;  // as of `updated`
+            size_t samples = 0;
+            std::chrono::steady_clock::time_point updated{};
+        };
+
+        std::string strong;
+        std::vector<std::string> fast;
+        std::string log_path;
+
+        std::mutex mtx;  // turns of several agents may route at once
+        std::map<std::string, Health> health;
+
+        double error_rate(const Health& h, std::chrono::steady_clock::time_point now) const;
+        bool healthy(const Health& h, std::chrono::steady_clock::time_point now) const;
+        void log(nlohmann::json line);
+    };
+}
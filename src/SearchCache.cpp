@@ -0,0 +1,286 @@
+#include "SearchCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Helpers.h"
+
+namespace lira
+{
+    namespace {
+        enum Counter : size_t { HITS, STALE_HITS, MISSES, STORES, EVICTIONS, REVALIDATIONS, NUM_COUNTERS };
+        constexpr size_t STATS_SIZE = 64;
+        static_assert(NUM_COUNTERS * sizeof(uint64_t) <= STATS_SIZE);
+
+        // A refresh marker older than this belongs to a process that died
+        constexpr long REVALIDATE_TIMEOUT = 60;
+
+        // Queries whose answers change within hours get a fraction of the TTL
+        constexpr std::string_view VOLATILE_WORDS[] = {
+            "today", "now", "latest", "news", "current", "price", "weather", "score", "live", "tonight"
+        };
+        constexpr long VOLATILE_TTL_DIVISOR = 12;
+
+        long now_seconds() {
+            using namespace std::chrono;
+            return static_cast<long>(duration_cast<seconds>(system_clock::now().time_since_epoch()).count());
+        }
+
+        uint64_t fnv1a(std::string_view s) {
+            uint64_t h = 0xcbf29ce484222325ull;
+            for (unsigned char c : s) { h ^= c; h *= 0x100000001b3ull; }
+            return h;
+        }
+
+        long ttl_for(const std::string& key) {
+            const long ttl = get_search_cache_ttl();
+            std::string_view rest = key;
+            while (!rest.empty()) {
+                const size_t sp = rest.find(' ');
+                const std::string_view word = rest.substr(0, sp);
+                if (std::ranges::find(VOLATILE_WORDS, word) != std::end(VOLATILE_WORDS)) return ttl / VOLATILE_TTL_DIVISOR;
+                if (sp == std::string_view::npos) break;
+                rest.remove_prefix(sp + 1);
+            }
+            return ttl;
+        }
+
+        // Serializes eviction, entry replacement and marker handling across
+        // threads and processes: flock on the shared descriptor only excludes
+        // other processes
+        struct DirLock {
+            std::lock_guard<std::mutex> guard;
+            int fd;
+            DirLock(std::mutex& m, int f) : guard(m), fd(f) { if (fd >= 0) flock(fd, LOCK_EX); }
+            ~DirLock() { if (fd >= 0) flock(fd, LOCK_UN); }
+        };
+    }
+
+    // --- Lifecycle ---
+    SearchCache::SearchCache(std::string d) : dir(std::move(d)) {
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        lock_fd = ::open((dir + "/.lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (ec || lock_fd < 0) {
+            if (lock_fd >= 0) ::close(lock_fd);
+            lock_fd = -1;
+            dir.clear();
+            return;
+        }
+
+        // Counters live in a tiny shared mapping so every process adds to the same totals
+        const int fd = ::open((dir + "/.stats").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) return;
+        struct stat st{};
+        if (fstat(fd, &st) == 0 && (static_cast<size_t>(st.st_size) >= STATS_SIZE || ftruncate(fd, STATS_SIZE) == 0)) {
+            void* p = mmap(nullptr, STATS_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) counters = static_cast<uint64_t*>(p);
+        }
+        ::close(fd);
+    }
+
+    SearchCache::~SearchCache() {
+        wait_revalidations();
+        if (counters) munmap(counters, STATS_SIZE);
+        if (lock_fd >= 0) ::close(lock_fd);
+    }
+
+    std::shared_ptr<SearchCache> SearchCache::shared() {
+        static std::shared_ptr<SearchCache> instance =
+            std::make_shared<SearchCache>(get_search_cache_ttl() > 0 ? SEARCH_CACHE_DIR : std::string());
+        return instance;
+    }
+
+    std::string SearchCache::normalize(std::string_view query) {
+        std::string out;
+        out.reserve(query.size());
+        for (char c : query) {
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                if (!out.empty() && out.back() != ' ') out += ' ';
+            } else {
+                out += (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+            }
+        }
+        if (!out.empty() && out.back() == ' ') out.pop_back();
+        return out;
+    }
+
+    std::string SearchCache::entry_path(const std::string& key) const {
+        return std::format("{}/{:016x}.json", dir, fnv1a(key));
+    }
+
+    void SearchCache::count(size_t counter) {
+        if (counters) std::atomic_ref<uint64_t>(counters[counter]).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    SearchCache::Stats SearchCache::stats() const {
+        Stats s;
+        if (!counters) return s;
+        auto load = [&](size_t c) { return std::atomic_ref<uint64_t>(counters[c]).load(std::memory_order_relaxed); };
+        s.hits = load(HITS);
+        s.stale_hits = load(STALE_HITS);
+        s.misses = load(MISSES);
+        s.stores = load(STORES);
+        s.evictions = load(EVICTIONS);
+        s.revalidations = load(REVALIDATIONS);
+        return s;
+    }
+
+    // --- Entries ---
+    std::optional<SearchCache::Lookup> SearchCache::lookup(const std::string& query) {
+        if (!enabled()) return std::nullopt;
+        const std::string key = normalize(query);
+        const std::string path = entry_path(key);
+
+        json entry;
+        try {
+            std::ifstream f(path);
+            if (!f) { count(MISSES); return std::nullopt; }
+            entry = json::parse(f);
+        } catch (...) {
+            count(MISSES);
+            return std::nullopt;
+        }
+        // Hash collision or foreign file
+        if (entry.value("q", "") != key || !entry.contains("r")) { count(MISSES); return std::nullopt; }
+
+        const long age = now_seconds() - entry.value("t", 0L);
+        const long ttl = entry.value("ttl", 0L);
+        if (age > ttl + get_search_cache_stale()) {
+            // store() may have replaced it since we read it; only the expired
+            // entry goes, and renames are held off while we check
+            DirLock lock(dir_mtx, lock_fd);
+            try {
+                std::ifstream f(path);
+                if (f && json::parse(f).value("t", 0L) == entry.value("t", 0L)) ::unlink(path.c_str());
+            } catch (...) {}
+            count(MISSES);
+            return std::nullopt;
+        }
+
+        // Mark as recently used for eviction
+        utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+        const bool stale = age > ttl;
+        count(stale ? STALE_HITS : HITS);
+        return Lookup{entry["r"].get<std::string>(), stale};
+    }
+
+    void SearchCache::store(const std::string& query, const std::string& result) {
+        if (!enabled()) return;
+        const std::string key = normalize(query);
+        const std::string path = entry_path(key);
+        const std::string body = json{{"q", key}, {"t", now_seconds()}, {"ttl", ttl_for(key)}, {"r", result}}.dump();
+
+        // Write aside and rename over the entry: concurrent readers see the old or the new file
+        std::string tmpl = path + ".XXXXXX";
+        const int fd = mkstemp(tmpl.data());
+        if (fd < 0) return;
+        bool ok = true;
+        for (size_t off = 0; ok && off < body.size();) {
+            const ssize_t n = ::write(fd, body.data() + off, body.size() - off);
+            ok = n > 0;
+            if (ok) off += static_cast<size_t>(n);
+        }
+        ::close(fd);
+        {
+            // lookup() drops expired entries under the lock
+            DirLock lock(dir_mtx, lock_fd);
+            ok = ok && ::rename(tmpl.c_str(), path.c_str()) == 0;
+        }
+        if (!ok) {
+            ::unlink(tmpl.c_str());
+            return;
+        }
+        count(STORES);
+        evict();
+    }
+
+    // Drops least recently used entries until the directory fits its budget.
+    // A directory scan is cheap next to the network request that preceded it.
+    void SearchCache::evict() {
+        struct Item { fs::path path; fs::file_time_type used; uintmax_t size; };
+        const uint64_t budget = get_search_cache_bytes();
+
+        DirLock lock(dir_mtx, lock_fd);
+        std::vector<Item> items;
+        uint64_t total = 0;
+        std::error_code ec;
+        for (const auto& e : fs::directory_iterator(dir, ec)) {
+            if (e.path().extension() != ".json") continue;
+            std::error_code fe;
+            const uintmax_t size = e.file_size(fe);
+            const auto used = e.last_write_time(fe);
+            if (fe) continue;
+            items.push_back({e.path(), used, size});
+            total += size;
+        }
+        if (total <= budget) return;
+
+        // Evict down to 90% so the next few stores don't rescan
+        std::ranges::sort(items, {}, &Item::used);
+        const uint64_t target = budget / 10 * 9;
+        for (const auto& item : items) {
+            if (total <= target) break;
+            if (fs::remove(item.path, ec)) {
+                total -= item.size;
+                count(EVICTIONS);
+            }
+        }
+    }
+
+    // --- Stale-While-Revalidate ---
+    bool SearchCache::begin_revalidate(const std::string& query) {
+        if (!enabled()) return false;
+        const std::string marker = entry_path(normalize(query)) + ".refresh";
+
+        DirLock lock(dir_mtx, lock_fd);
+        struct stat st{};
+        if (stat(marker.c_str(), &st) == 0 && now_seconds() - st.st_mtime < REVALIDATE_TIMEOUT) return false;
+        const int fd = ::open(marker.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        ::close(fd);
+        count(REVALIDATIONS);
+        return true;
+    }
+
+    void SearchCache::end_revalidate(const std::string& query) {
+        if (!enabled()) return;
+        ::unlink((entry_path(normalize(query)) + ".refresh").c_str());
+    }
+
+    void SearchCache::revalidate_async(const std::string& query, std::function<std::string()> fetch) {
+        std::lock_guard lock(refresh_mtx);
+        // Reap finished refreshes so the list stays short
+        for (auto it = refreshes.begin(); it != refreshes.end();) {
+            if (!it->done.load(std::memory_order_acquire)) { ++it; continue; }
+            it->thread.join();
+            it = refreshes.erase(it);
+        }
+        Refresh& r = refreshes.emplace_back();
+        r.thread = std::thread([this, &r, query, fetch = std::move(fetch)] {
+            try {
+                if (std::string fresh = fetch(); !fresh.empty()) store(query, fresh);
+            } catch (...) {}
+            end_revalidate(query);
+            r.done.store(true, std::memory_order_release);
+        });
+    }
+
+    void SearchCache::wait_revalidations() {
+        std::list<Refresh> pending;
+        {
+            std::lock_guard lock(refresh_mtx);
+            pending.splice(pending.end(), refreshes);
+        }
+        for (auto& r : pending) r.thread.join();
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace lira
+{
+    // Persistent cache of web search results shared by all lira processes.
+    // One file per normalized query under SEARCH_CACHE_DIR, replaced by atomic
+    // rename so readers never see a partial entry. A file's mtime is its last
+    // use: hits touch it and eviction removes the least recently used entries
+    // once the directory grows past its byte budget. Entries past their TTL are
+    // still served for a grace period while one process refreshes them.
+    class SearchCache {
+    public:
+        struct Stats {
+            uint64_t hits = 0;          // fresh entries served
+            uint64_t stale_hits = 0;    // expired entries served while refreshing
+            uint64_t misses = 0;
+            uint64_t stores = 0;
+            uint64_t evictions = 0;
+            uint64_t revalidations = 0; // background refreshes started
+
+            double hit_rate() const {
+                const uint64_t total = hits + stale_hits + misses;
+                return total ? static_cast<double>(hits + stale_hits) / total : 0.0;
+            }
+        };
+
+        struct Lookup {
+            std::string result;
+            bool stale = false;
+        };
+
+        explicit SearchCache(std::string dir);
+        ~SearchCache();
+        SearchCache(const SearchCache&) = delete;
+        SearchCache& operator=(const SearchCache&) = delete;
+
+        // One instance per process. Background refreshes use it by raw
+        // pointer; the destructor joins them first.
+        static std::shared_ptr<SearchCache> shared();
+
+        // Lower-case, trimmed, single-spaced: "  Rust  ASYNC " -> "rust async"
+        static std::string normalize(std::string_view query);
+
+        std::optional<Lookup> lookup(const std::string& query);
+        void store(const std::string& query, const std::string& result);
+
+        // Claims the refresh of a stale entry; false if another thread or process has it
+        bool begin_revalidate(const std::string& query);
+        void end_revalidate(const std::string& query);
+        // Runs `fetch` for a claimed query on a background thread, stores a
+        // non-empty result and releases the claim. The destructor joins it.
+        void revalidate_async(const std::string& query, std::function<std::string()> fetch);
+        // Blocks until every background refresh is done
+        void wait_revalidations();
+
+        // Counters accumulated across all processes
+        Stats stats() const;
+        bool enabled() const { return !dir.empty(); }
+
+    private:
+        std::string dir;
+        int lock_fd = -1;
+        std::mutex dir_mtx;           // flock only excludes other processes, not our threads
+        uint64_t* counters = nullptr; // mmapped stats file, updated atomically
+
+        struct Refresh {
+            std::thread thread;
+            std::atomic<bool> done{false};
+        };
+        std::mutex refresh_mtx;
+        std::list<Refresh> refreshes;
+
+        std::string entry_path(const std::string& key) const;
+        void count(size_t counter);
+        void evict();
+    };
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace lira
+{
+    // Bounded single-producer/single-consumer queue. Lock-free: each side
+    // owns one index and publishes it with release/acquire; the indices live
+    // on separate cache lines so producer and consumer don't false-share.
+    template<typename T, size_t Capacity>
+    class SpscRing {
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+        std::array<T, Capacity> slots{};
+        alignas(64) std::atomic<size_t> head{0};  // next slot to read (consumer)
+        alignas(64) std::atomic<size_t> tail{0};  // next slot to write (producer)
+
+    public:
+        // Producer side. Returns false when full; `item` is left untouched then.
+        bool try_push(T&& item) {
+            const size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+            slots[t & (Capacity - 1)] = std::move(item);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side
+        bool try_pop(T& out) {
+            const size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) return false;
+            out = std::move(slots[h & (Capacity - 1)]);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool empty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+    };
+}
@@ -1,7 +1,19 @@
 #include "StreamRenderer.h"
+#include "TerminalWriter.h"
+#include "Trace.h"
 #include <iostream>
+#include <algorithm>
 #include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <format>
 #include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace lira
 {
@@ -23,68 +35,119 @@ namespace lira
     const std::string COM_COLOR    = "\033[90m";   // Gray
     const std::string NUM_COLOR    = "\033[0;33m"; // Yellow
 
-    // Universal Keywords List
-    const std::set<std::string> KW_SET_IMPL = {
-        "auto", "const", "class", "struct", "int", "void", "string", "bool", "char",
-        "if", "else", "for", "while", "do", "return", "switch", "case", "break",
-        "namespace", "using", "template", "typename", "public", "private", "protected",
-        "import", "from", "def", "lambda", "try", "except", "finally", "with", "as",
-        "var", "let", "function", "async", "await", "echo", "sudo", "cd",
-        "ls", "grep", "cat", "chmod", "chown", "mkdir", "rm", "mv", "cp", "true", "false",
-        "null", "nullptr", "this", "new", "delete", "std", "vector", "map", "set",
-        "g++", "gcc", "make", "cmake", "git", "npm", "pip", "docker"
+    // Tags whose content is hidden from the user. "<write" takes attributes.
+    constexpr ToolTag TOOL_TAGS[] = {
+        {"<remember>", "</remember>"},
+        {"<cmd>", "</cmd>"},
+        {"<search>", "</search>"},
+        {"<fetch>", "</fetch>"},
+        {"<spawn>", "</spawn>"},
+        {"<write", "</write>"},
+        {"<think>", "</think>"},
     };
 
+    constexpr size_t MAX_WRITE_ATTRS = 1024;
+
     // --- Constructor ---
     StreamRenderer::StreamRenderer(RenderCallback callback)
-        : output_callback(std::move(callback)) {}
+        : output_callback(std::move(callback)) {
+        select_language();
+    }
 
     // --- Internal Helper: Emit ---
-    // Centralizes logic for sending data to CLI (cout) or GUI (callback)
-    void StreamRenderer::emit(TokenType type, const std::string& content) {
+    // Flushes any pending run first so output order is preserved
+    void StreamRenderer::emit(TokenType type, std::string_view content) {
+        flush_run();
+        write_span(type, content);
+    }
+
+    // --- Run Coalescing ---
+    // Consecutive characters with the same style are collected and sent as one
+    // span instead of one callback / stream write per character.
+    void StreamRenderer::push(TokenType type, std::string_view text) {
+        if (!run_buffer.empty() && type != run_type) flush_run();
+        run_type = type;
+        run_buffer += text;
+    }
+
+    void StreamRenderer::flush_run() {
+        if (run_buffer.empty()) return;
+        write_span(run_type, run_buffer);
+        run_buffer.clear(); // keeps capacity
+    }
+
+    // Centralizes logic for sending data to CLI (terminal writer) or GUI (callback)
+    void StreamRenderer::write_span(TokenType type, std::string_view content) {
         if (output_callback) {
             // GUI Mode: Send structured token
             output_callback(type, content);
-        } else {
-            // CLI Mode: Print with ANSI formatting
-            switch (type) {
-            case TokenType::Text:
-                std::cout << content;
-                break;
-            case TokenType::Bold:
-                // Gray text for actions/bold
-                std::cout << ANSI_GRAY << content << ANSI_RESET;
-                break;
-            case TokenType::InlineCode:
-                std::cout << ANSI_CYAN << content << ANSI_RESET;
-                break;
-            case TokenType::Thinking:
-                // Handled separately by render_think_spinner for animation
-                // But if we get a static chunk:
-                std::cout << ANSI_MAGENTA << content << ANSI_RESET;
-                break;
-            case TokenType::CodeBlockStart:
-                // Top of the box
-                std::cout << "\n" << ANSI_CYAN << "╭─[ " << ANSI_YELLOW << content << ANSI_CYAN << " ]" << ANSI_RESET << "\n";
-                std::cout << ANSI_CYAN << "│ " << ANSI_RESET;
-                break;
-            case TokenType::CodeBlockContent:
-                // Content is printed raw here; syntax highlighting handles colors before calling this
-                // or we assume content already has colors if passed from flush_word (for CLI)
-                // However, flush_word calls std::cout directly in CLI mode to handle colors finely.
-                // This case is mostly for GUI fallback or uncolored blocks.
-                std::cout << content;
-                break;
-            case TokenType::CodeBlockEnd:
-                // Bottom of the box
-                std::cout << "\n" << ANSI_CYAN << "╰──────────────────────────────────────────" << ANSI_RESET << "\n";
-                break;
-            case TokenType::ToolOutput:
-                // Usually hidden, but if shown:
-                std::cout << ANSI_BLUE << content << ANSI_RESET;
-                break;
-            }
-            std::cout << std::flush;
+            return;
+        }
+
+        // CLI Mode: Each span selects its color up front; the terminal writer
+        // drops switches to the color that is already active.
+        auto& term = TerminalWriter::out();
+        switch (type) {
+        case TokenType::Text:
+            term.color(ANSI_RESET);
+            term.write(content);
+            break;
+        case TokenType::Bold:
+            // Gray text for actions/bold
+            term.color(ANSI_GRAY);
+            term.write(content);
+            break;
+        case TokenType::InlineCode:
+            term.color(ANSI_CYAN);
+            term.write(content);
+            break;
+        case TokenType::Thinking:
+            // Handled separately by render_think_spinner for animation
+            // But if we get a static chunk:
+            term.color(ANSI_MAGENTA);
+            term.write(content);
+            break;
+        case TokenType::CodeBlockStart:
+            // Top of the box
+            term.write("\n");
+            term.color(ANSI_CYAN); term.write("╭─[ ");
+            term.color(ANSI_YELLOW); term.write(content);
+            term.color(ANSI_CYAN); term.write(" ]");
+            term.color(ANSI_RESET); term.write("\n");
+            term.color(ANSI_CYAN); term.write("│ ");
+            term.color(ANSI_RESET);
+            break;
+        case TokenType::CodeBlockContent:
+            term.color(ANSI_CODE);
+            term.write(content);
+            break;
+        case TokenType::CodeKeyword:
+            term.color(KW_COLOR);
+            term.write(content);
+            break;
+        case TokenType::CodeString:
+            term.color(STR_COLOR);
+            term.write(content);
+            break;
+        case TokenType::CodeComment:
+            term.color(COM_COLOR);
+            term.write(content);
+            break;
+        case TokenType::CodeNumber:
+            term.color(NUM_COLOR);
+            term.write(content);
+            break;
+        case TokenType::CodeBlockEnd:
+            // Bottom of the box
+            term.write("\n");
+            term.color(ANSI_CYAN); term.write("╰──────────────────────────────────────────");
+            term.color(ANSI_RESET); term.write("\n");
+            break;
+        case TokenType::ToolOutput:
+            // Usually hidden, but if shown:
+            term.color(ANSI_BLUE);
+            term.write(content);
+            break;
         }
     }
 
@@ -92,26 +155,20 @@ namespace lira
     void StreamRenderer::flush_word() {
         if (word_buffer.empty()) return;
 
-        if (output_callback) {
-            // GUI Mode: Just send content.
-            // Note: Real syntax highlighting in ImGui requires complex logic (e.g. ImGuiColorTextEdit).
-            // For now, we send raw text to the code block.
-            output_callback(TokenType::CodeBlockContent, word_buffer);
+        // GUI gets the class as the token type, CLI maps it to a color
+        if (std::isdigit(static_cast<unsigned char>(word_buffer[0]))) {
+            push(TokenType::CodeNumber, word_buffer);
+        } else if (lang->is_keyword(word_buffer)) {
+            push(TokenType::CodeKeyword, word_buffer);
         } else {
-            // CLI Mode: Apply ANSI Colors
-            if (isdigit(word_buffer[0])) {
-                std::cout << NUM_COLOR << word_buffer;
-            } else if (KW_SET_IMPL.contains(word_buffer)) {
-                std::cout << KW_COLOR << word_buffer;
-            } else {
-                std::cout << ANSI_CODE << word_buffer;
-            }
+            push(TokenType::CodeBlockContent, word_buffer);
         }
         word_buffer.clear();
     }
 
     // --- Thinking Animation ---
     void StreamRenderer::render_think_spinner() {
+        flush_run();
         if (output_callback) {
             // GUI Mode: Send a status update
             // We use a special token or just update a status line
@@ -121,235 +178,497 @@ namespace lira
             const char* spinner[] = { "⠋", "⠙", "⠹", "⠸", "⠼", "⠴", "⠦", "⠧", "⠇", "⠏" };
             int frame = (think_spinner_idx++) % 10;
             // \r to overwrite line, \033[K to clear it
-            std::cout << "\r" << ANSI_MAGENTA << spinner[frame] << " (Lira is thinking...)" << ANSI_RESET << std::flush;
+            auto& term = TerminalWriter::out();
+            term.write("\r");
+            term.color(ANSI_MAGENTA);
+            term.write(spinner[frame]);
+            term.write(" (Lira is thinking...)");
+            term.color(ANSI_RESET);
+            term.maybe_flush();
         }
     }
 
-    // --- Main Processing Loop ---
-    void StreamRenderer::print(const std::string& chunk) {
-        full_response += chunk;
-        std::string processing = tag_lookahead + chunk;
-        tag_lookahead = "";
+    // --- Special Byte Scan ---
+    // Returns the offset of the first byte in [p, p+n) that appears in `set`
+    // (at most 8 bytes), or n. Plain text between specials is consumed in bulk.
+    static size_t scan_special(const char* p, size_t n, std::string_view set) {
+        size_t i = 0;
+#if defined(__SSE2__)
+        __m128i needles[8];
+        const size_t k = std::min<size_t>(set.size(), 8);
+        for (size_t j = 0; j < k; ++j) needles[j] = _mm_set1_epi8(set[j]);
+        for (; i + 16 <= n; i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            __m128i hit = _mm_cmpeq_epi8(v, needles[0]);
+            for (size_t j = 1; j < k; ++j) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, needles[j]));
+            if (const int mask = _mm_movemask_epi8(hit)) return i + __builtin_ctz(mask);
+        }
+#elif defined(__ARM_NEON)
+        uint8x16_t needles[8];
+        const size_t k = std::min<size_t>(set.size(), 8);
+        for (size_t j = 0; j < k; ++j) needles[j] = vdupq_n_u8(static_cast<uint8_t>(set[j]));
+        for (; i + 16 <= n; i += 16) {
+            const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p + i));
+            uint8x16_t hit = vceqq_u8(v, needles[0]);
+            for (size_t j = 1; j < k; ++j) hit = vorrq_u8(hit, vceqq_u8(v, needles[j]));
+            // Narrow to 4 bits per byte so the whole vector fits in one u64
+            const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+            if (mask) return i + (__builtin_ctzll(mask) >> 2);
+        }
+#endif
+        for (; i < n; ++i) if (set.find(p[i]) != std::string_view::npos) return i;
+        return n;
+    }
 
-        // Animate spinner if thinking
-        if (in_thinking) {
-            render_think_spinner();
+    // Bytes that may change state in the current mode; everything else is plain
+    std::string_view StreamRenderer::special_bytes() const {
+        if (in_write_attrs) return ">";
+        if (hiding_output || in_thinking) return "<";
+        if (!in_code_block) return "<`*";
+        if (awaiting_lang_name || in_comment) return "<`\n";
+        if (in_block_comment) return "<`\n*/";
+        if (in_string) {
+            if (string_char == '"') return "<`\n\\\"";
+            if (string_char == '\'') return "<`\n\\'";
+            return "<`\n\\";
         }
+        return code_specials;
+    }
 
-        for (size_t i = 0; i < processing.length(); ++i) {
-            char c = processing[i];
+    bool StreamRenderer::has_pending_token() const {
+        return tag_len > 0 || ticks > 0 || star_pending || slash_pending || closer_matched > 0;
+    }
 
-            // Init cleanup (swallow leading whitespace)
-            if (is_first_char) {
-                if (c == '\t' || c == ' ' || c == '\n' || c == '\r') continue;
-                is_first_char = false;
+    // --- Plain Runs ---
+    // Bulk equivalent of put() for a span containing no special bytes
+    void StreamRenderer::consume_plain(const char* p, size_t len) {
+        if (in_write_attrs) { write_attrs.append(p, std::min(len, MAX_WRITE_ATTRS - std::min(write_attrs.size(), MAX_WRITE_ATTRS))); return; }
+        if (in_write_body()) { write_sink.write({p, len}); return; }
+        if (hiding_output || in_thinking) return;
+        visible_response.append(p, len);
+
+        if (!in_code_block) {
+            push(in_gray_block ? TokenType::Bold : in_inline_code ? TokenType::InlineCode : TokenType::Text, {p, len});
+            return;
+        }
+        if (awaiting_lang_name) { lang_buffer.append(p, len); return; }
+        prev_code_char = p[len - 1];
+        if (in_string) { string_escape = false; push(TokenType::CodeString, {p, len}); return; }
+        if (in_comment || in_block_comment) { push(TokenType::CodeComment, {p, len}); return; }
+
+        // Split identifiers (highlighted per word) from punctuation and spaces
+        auto is_word = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+        size_t j = 0;
+        while (j < len) {
+            const size_t start = j;
+            if (is_word(p[j])) {
+                while (j < len && is_word(p[j])) ++j;
+                word_buffer.append(p + start, j - start);
+            } else {
+                flush_word();
+                while (j < len && !is_word(p[j])) ++j;
+                push(TokenType::CodeBlockContent, {p + start, j - start});
             }
+        }
+    }
 
-            // --- 1. Tool Hiding Logic ---
-            if (hiding_output) {
-                format_buffer += c;
-                if (format_buffer.ends_with(target_closer)) {
-                    hiding_output = false;
-                    format_buffer = "";
-                    target_closer = "";
-                }
-                continue;
-            }
+    // --- Ordinary Characters ---
+    // Anything that needs no lookahead; multi-byte tokens are resolved in feed()
+    void StreamRenderer::put(char c) {
+        visible_response += c;
 
-            // --- 2. Thinking Logic (<think>) ---
-            if (in_thinking) {
-                format_buffer += c;
-                if (format_buffer.ends_with("</think>")) {
-                    in_thinking = false;
-                    format_buffer = "";
-                    // Clear CLI line
-                    if (!output_callback) std::cout << "\r\033[K" << std::flush;
-                }
-                continue;
+        // Normal Text Formatting
+        if (!in_code_block) {
+            push(in_gray_block ? TokenType::Bold : in_inline_code ? TokenType::InlineCode : TokenType::Text, {&c, 1});
+            return;
+        }
+
+        // Phase A: Language Name (e.g. "cpp")
+        if (awaiting_lang_name) {
+            if (c == '\n') {
+                awaiting_lang_name = false;
+                select_language();
+                emit(TokenType::CodeBlockStart, lang_buffer.empty() ? "Code" : lang_buffer);
+            } else {
+                lang_buffer += c;
             }
+            return;
+        }
 
-            // --- 3. Lookahead ---
-            // Prevent splitting tags or markdown tokens across chunks
-            if (i >= processing.length() - 2) {
-                if (c == '<' || c == '*' || c == '`') {
-                    tag_lookahead = processing.substr(i);
-                    return;
-                }
+        // Phase B: Left Border & Newlines
+        if (c == '\n') {
+            flush_word();
+            in_string = false;
+            string_escape = false;
+            in_comment = false;
+            prev_code_char = c;
+
+            if (output_callback) {
+                push(TokenType::CodeBlockContent, "\n");
+            } else {
+                flush_run();
+                auto& term = TerminalWriter::out();
+                term.color(ANSI_RESET); term.write("\n");
+                term.color(ANSI_CYAN); term.write("│ ");
+                term.color(ANSI_RESET);
             }
+            return;
+        }
 
-            // --- 4. Tag Detection ---
-            if (c == '<') {
-                std::string remainder = processing.substr(i);
-                // If we don't have enough chars to decide, lookahead
-                if (remainder.length() < 12 && remainder.find('>') == std::string::npos) {
-                    tag_lookahead = remainder; return;
-                }
+        // Phase C: Syntax Highlighting
+        const char prev = prev_code_char;
+        prev_code_char = c;
+        if (in_string) {
+            push(TokenType::CodeString, {&c, 1});
+            if (string_escape) string_escape = false;
+            else if (c == '\\') string_escape = true;
+            else if (c == string_char) in_string = false;
+            return;
+        }
+        if (in_comment) {
+            push(TokenType::CodeComment, {&c, 1});
+            return;
+        }
+        if (in_block_comment) {
+            push(TokenType::CodeComment, {&c, 1});
+            if (c == '/' && prev == '*') in_block_comment = false;
+            return;
+        }
 
-                if (remainder.starts_with("<remember>")) { hiding_output = true; target_closer = "</remember>"; format_buffer += c; continue; }
-                if (remainder.starts_with("<cmd>")) { hiding_output = true; target_closer = "</cmd>"; format_buffer += c; continue; }
-                if (remainder.starts_with("<search>")) { hiding_output = true; target_closer = "</search>"; format_buffer += c; continue; }
-                if (remainder.starts_with("<write")) { hiding_output = true; target_closer = "</write>"; format_buffer += c; continue; }
+        // Start String
+        if (lang->quotes.find(c) != std::string_view::npos) {
+            flush_word();
+            in_string = true;
+            string_char = c;
+            push(TokenType::CodeString, {&c, 1});
+            return;
+        }
 
-                if (remainder.starts_with("<think>")) {
-                    in_thinking = true;
-                    format_buffer += c;
-                    render_think_spinner();
-                    continue;
-                }
+        // '#': comment, preprocessor directive or plain ("//" and "/*" arrive via feed())
+        if (c == '#') {
+            if (lang->hash_directives) {
+                flush_word();
+                word_buffer += c;
+                return;
             }
-
-            // Capture visible content
-            visible_response += c;
-
-            // --- 5. Code Block Boundaries (```) ---
-            if (processing.substr(i).starts_with("```")) {
-                if (!in_code_block) {
-                    // STARTING BLOCK
-                    in_code_block = true;
-                    awaiting_lang_name = true;
-                    lang_buffer = "";
-                    // If CLI, ensure separation
-                    if (!output_callback) std::cout << "\n";
-                } else {
-                    // ENDING BLOCK
-                    if (awaiting_lang_name) {
-                        // Edge case: One-line block ` ```cmd content... `
-                        emit(TokenType::CodeBlockStart, "Command");
-                        emit(TokenType::CodeBlockContent, lang_buffer);
-                        awaiting_lang_name = false;
-                    } else {
-                        flush_word(); // Flush remaining code buffer
-                    }
-
-                    in_code_block = false;
-                    in_string = false;
-                    in_comment = false;
-
-                    emit(TokenType::CodeBlockEnd, "");
-                }
-                i += 2; continue;
+            if (lang->hash_comments && (!lang->hash_needs_boundary || prev == ' ' || prev == '\t' || prev == '\n')) {
+                start_comment("#");
+                return;
             }
+        }
 
-            // --- 6. Code Block Content ---
-            if (in_code_block) {
-                // Phase A: Language Name (e.g. "cpp")
-                if (awaiting_lang_name) {
-                    if (c == '\n') {
-                        awaiting_lang_name = false;
-                        std::string label = lang_buffer.empty() ? "Code" : lang_buffer;
-                        emit(TokenType::CodeBlockStart, label);
-                    } else {
-                        lang_buffer += c;
-                    }
-                    continue;
-                }
+        // Token Buffer
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            word_buffer += c;
+        } else {
+            flush_word();
+            push(TokenType::CodeBlockContent, {&c, 1});
+        }
+    }
 
-                // Phase B: Left Border & Newlines
-                if (c == '\n') {
-                    flush_word();
-                    in_string = false;
-                    in_comment = false;
-
-                    if (output_callback) {
-                        output_callback(TokenType::CodeBlockContent, "\n");
-                    } else {
-                        std::cout << ANSI_RESET << "\n" << ANSI_CYAN << "│ " << ANSI_RESET;
-                    }
-                    continue;
-                }
+    void StreamRenderer::start_comment(std::string_view marker) {
+        flush_word();
+        in_comment = true;
+        push(TokenType::CodeComment, marker);
+    }
 
-                // Phase C: Syntax Highlighting
-                if (in_string) {
-                    if (output_callback) output_callback(TokenType::CodeBlockContent, std::string(1, c));
-                    else { std::cout << STR_COLOR << c; }
+    void StreamRenderer::start_block_comment() {
+        flush_word();
+        in_block_comment = true;
+        prev_code_char = 0; // "/*/" does not close
+        push(TokenType::CodeComment, "/*");
+    }
 
-                    if (c == string_char) in_string = false;
-                    continue;
-                }
-                if (in_comment) {
-                    if (output_callback) output_callback(TokenType::CodeBlockContent, std::string(1, c));
-                    else { std::cout << COM_COLOR << c; }
-                    continue;
-                }
+    // Lexer for the current fence tag; the generic one until the tag is known
+    void StreamRenderer::select_language() {
+        lang = &syntax::language_for(awaiting_lang_name ? std::string_view{} : std::string_view{lang_buffer});
+        code_specials = "<`\n";
+        for (char q : lang->quotes) if (q != '`') code_specials += q;
+        if (lang->hash_comments || lang->hash_directives) code_specials += '#';
+        if (lang->slash_comments) code_specials += '/';
+    }
 
-                // Start String
-                if (c == '"' || c == '\'') {
-                    flush_word();
-                    in_string = true;
-                    string_char = c;
+    // --- Code Block Boundaries (```) ---
+    void StreamRenderer::toggle_fence() {
+        visible_response += "```";
+        if (!in_code_block) {
+            // STARTING BLOCK
+            in_code_block = true;
+            awaiting_lang_name = true;
+            lang_buffer.clear();
+            prev_code_char = '\n';
+            in_inline_code = false;
+            // If CLI, ensure separation
+            flush_run();
+            if (!output_callback) TerminalWriter::out().write("\n");
+            return;
+        }
 
-                    if (output_callback) output_callback(TokenType::CodeBlockContent, std::string(1, c));
-                    else { std::cout << STR_COLOR << c; }
-                    continue;
-                }
+        // ENDING BLOCK
+        if (awaiting_lang_name) {
+            // Edge case: One-line block ` ```cmd content... `
+            emit(TokenType::CodeBlockStart, "Command");
+            emit(TokenType::CodeBlockContent, lang_buffer);
+            awaiting_lang_name = false;
+        } else {
+            flush_word(); // Flush remaining code buffer
+        }
 
-                // Start Comment
-                if (c == '#' || (c == '/' && i+1 < processing.length() && processing[i+1] == '/')) {
-                    flush_word();
-                    in_comment = true;
+        in_code_block = false;
+        in_string = false;
+        string_escape = false;
+        in_comment = false;
+        in_block_comment = false;
+        select_language();
 
-                    if (output_callback) output_callback(TokenType::CodeBlockContent, std::string(1, c));
-                    else { std::cout << COM_COLOR << c; }
-                    continue;
-                }
+        emit(TokenType::CodeBlockEnd, "");
+    }
 
-                // Token Buffer
-                if (isalnum(c) || c == '_') {
-                    word_buffer += c;
-                } else {
-                    flush_word();
-                    if (output_callback) output_callback(TokenType::CodeBlockContent, std::string(1, c));
-                    else { std::cout << ANSI_CODE << c; }
-                }
-                continue;
+    // One or two backticks followed by something else
+    void StreamRenderer::resolve_ticks() {
+        for (; ticks > 0; --ticks) {
+            if (in_code_block) { put('`'); continue; }
+            // `inline code`
+            visible_response += '`';
+            in_inline_code = !in_inline_code;
+        }
+    }
+
+    // A single '*': closes an open *action*, stays literal as a list bullet
+    void StreamRenderer::resolve_star(bool next_is_space) {
+        if (in_gray_block) { visible_response += '*'; in_gray_block = false; }
+        else if (next_is_space) put('*');
+        else { visible_response += '*'; in_gray_block = true; }
+    }
+
+    // --- Tool Tags ---
+    void StreamRenderer::feed_tag(char c) {
+        tag_buf[tag_len++] = c;
+        const std::string_view candidate(tag_buf, tag_len);
+        bool is_prefix = false;
+        for (const auto& tag : TOOL_TAGS) {
+            if (tag.opener == candidate) { tag_len = 0; open_tag(tag); return; }
+            if (tag.opener.starts_with(candidate)) is_prefix = true;
+        }
+        if (is_prefix) return;
+
+        // Not a tag: '<' is an ordinary character, the rest gets re-examined
+        char replay[sizeof(tag_buf)];
+        const size_t n = tag_len - 1;
+        std::memcpy(replay, tag_buf + 1, n);
+        tag_len = 0;
+        put('<');
+        for (size_t i = 0; i < n; ++i) feed(replay[i]);
+    }
+
+    void StreamRenderer::open_tag(const ToolTag& tag) {
+        target_closer = tag.closer;
+        closer_matched = 0;
+        if (tag.opener == "<think>") {
+            in_thinking = true;
+            render_think_spinner();
+        } else {
+            hiding_output = true;
+            if (tag.opener == "<write") { in_write_attrs = true; write_attrs.clear(); }
+        }
+    }
+
+    // --- Streaming <write> ---
+    bool StreamRenderer::in_write_body() const {
+        return hiding_output && !in_write_attrs && target_closer == "</write>";
+    }
+
+    // Attributes are complete: open the temp file for file="..."
+    void StreamRenderer::begin_write() {
+        in_write_attrs = false;
+        if (!apply_writes) return;
+        const auto key = write_attrs.find("file=\"");
+        const auto end = key == std::string::npos ? key : write_attrs.find('"', key + 6);
+        if (end == std::string::npos) {
+            writes.push_back({"", 0, false, "missing file=\"...\" attribute"});
+            return;
+        }
+        const std::string fname = write_attrs.substr(key + 6, end - key - 6);
+        if (!write_sink.open(fname)) {
+            writes.push_back({fname, 0, false, std::strerror(errno)});
+        }
+    }
+
+    void StreamRenderer::end_write(bool completed) {
+        if (!write_sink.is_open()) {
+            // begin_write() could not open the file and recorded why; the
+            // model must see that too, not an empty write
+            if (completed && apply_writes && !writes.empty() && !writes.back().ok)
+                full_response += std::format("[write failed: {}]", writes.back().error);
+            return;
+        }
+        WriteResult result;
+        result.path = write_sink.target();
+        if (completed) {
+            result.ok = write_sink.commit(result.error);
+        } else {
+            write_sink.abort();
+            result.error = "stream ended before </write>";
+        }
+        result.bytes = write_sink.bytes_written();
+        // History keeps a stub instead of the whole file
+        if (completed) {
+            full_response += result.ok ? std::format("[{} bytes written to disk]", result.bytes)
+                                       : std::format("[write failed: {}]", result.error);
+        }
+        writes.push_back(std::move(result));
+    }
+
+    // Incremental match of the closing tag; closers only contain '<' at the front
+    void StreamRenderer::match_closer(char c) {
+        if (c == target_closer[closer_matched]) {
+            if (++closer_matched < target_closer.size()) return;
+            closer_matched = 0;
+            if (in_write_body()) {
+                end_write(true);
+                full_response += target_closer;
             }
+            if (in_thinking) {
+                in_thinking = false;
+                // Clear CLI line
+                if (!output_callback) TerminalWriter::out().write("\r\033[K");
+            } else {
+                hiding_output = false;
+            }
+            return;
+        }
+        // What looked like the start of the closer was content after all
+        const bool to_disk = in_write_body();
+        if (to_disk && closer_matched > 0) write_sink.write(target_closer.substr(0, closer_matched));
+        closer_matched = (c == '<') ? 1 : 0;
+        if (to_disk && c != '<') write_sink.write({&c, 1});
+    }
 
-            // --- 7. Normal Text Formatting ---
-            if (!in_code_block) {
-                // **bold**
-                if (processing.substr(i).starts_with("**")) {
-                    in_gray_block = !in_gray_block;
-                    i += 1; continue;
-                }
-                // *action* (single star, unless list item)
-                if (processing.substr(i).starts_with("*") && !in_gray_block) {
-                    bool is_list = (i + 1 < processing.length() && processing[i+1] == ' ');
-                    if (!is_list) {
-                        in_gray_block = !in_gray_block;
-                        continue;
-                    }
-                }
-                // `inline code`
-                if (c == '`') {
-                    in_inline_code = !in_inline_code;
-                    continue;
-                }
+    // --- Tokenizer Step ---
+    // Handles one special byte, or a byte that completes a pending token
+    void StreamRenderer::feed(char c) {
+        // 1. Hidden regions only look for their closing tag
+        if (in_write_attrs) {
+            if (c == '>') begin_write();
+            else if (write_attrs.size() < MAX_WRITE_ATTRS) write_attrs += c;
+            return;
+        }
+        if (hiding_output || in_thinking) { match_closer(c); return; }
+
+        // 2. Partial tag
+        if (tag_len > 0) { feed_tag(c); return; }
+
+        // 3. Pending backticks
+        if (ticks > 0) {
+            if (c == '`') {
+                if (++ticks == 3) { ticks = 0; toggle_fence(); }
+                return;
+            }
+            resolve_ticks();
+        }
+
+        // 4. Pending '*' (**bold** vs *action* vs list bullet)
+        if (star_pending) {
+            star_pending = false;
+            if (c == '*') { visible_response += "**"; in_gray_block = !in_gray_block; return; }
+            resolve_star(c == ' ');
+        }
+
+        // 5. Pending '/' inside code
+        if (slash_pending) {
+            slash_pending = false;
+            if (c == '/') { visible_response += "//"; start_comment("//"); return; }
+            if (c == '*' && lang->block_comments) { visible_response += "/*"; start_block_comment(); return; }
+            put('/');
+        }
+
+        switch (c) {
+        case '<':
+            tag_buf[0] = c; tag_len = 1;
+            return;
+        case '`':
+            ticks = 1;
+            return;
+        case '*':
+            if (!in_code_block && !in_inline_code) { star_pending = true; return; }
+            break;
+        case '/':
+            if (in_code_block && !awaiting_lang_name && !in_string && !in_comment && !in_block_comment && lang->slash_comments) { slash_pending = true; return; }
+            break;
+        default:
+            break;
+        }
+        put(c);
+    }
+
+    // --- Main Processing Loop ---
+    void StreamRenderer::print(std::string_view chunk) {
+        trace::Span span("render", "print");
+        // Animate spinner if thinking
+        if (in_thinking) {
+            render_think_spinner();
+        }
+
+        const char* p = chunk.data();
+        const size_t n = chunk.size();
+        size_t i = 0;
+
+        // Init cleanup (swallow leading whitespace)
+        while (is_first_char && i < n) {
+            const char c = p[i];
+            if (c == '\t' || c == ' ' || c == '\n' || c == '\r') full_response += p[i++];
+            else is_first_char = false;
+        }
 
-                // Emit based on state
-                if (in_gray_block) {
-                    emit(TokenType::Bold, std::string(1, c));
-                } else if (in_inline_code) {
-                    emit(TokenType::InlineCode, std::string(1, c));
-                } else {
-                    emit(TokenType::Text, std::string(1, c));
+        while (i < n) {
+            // full_response gets everything except <write> bodies (see end_write)
+            const bool keep = !in_write_body();
+            if (!has_pending_token()) {
+                const size_t len = scan_special(p + i, n - i, special_bytes());
+                if (len > 0) {
+                    if (keep) full_response.append(p + i, len);
+                    consume_plain(p + i, len);
+                    i += len;
+                    continue;
                 }
             }
+            if (keep) full_response += p[i];
+            feed(p[i++]);
         }
 
-        if (!output_callback) std::cout << std::flush;
+        // One span per run; the terminal writer paces the actual flushes
+        flush_run();
+        if (!output_callback) TerminalWriter::out().maybe_flush();
     }
 
-    void StreamRenderer::finish() const {
-        if(!tag_lookahead.empty()) {
-            if (output_callback) output_callback(TokenType::Text, tag_lookahead);
-            else std::cout << tag_lookahead;
+    void StreamRenderer::finish() {
+        trace::Span span("render", "finish");
+        // Resolve tokens still waiting for lookahead
+        if (tag_len > 0) {
+            const size_t n = tag_len;
+            tag_len = 0;
+            for (size_t i = 0; i < n; ++i) put(tag_buf[i]);
         }
+        if (ticks > 0) resolve_ticks();
+        if (star_pending) { star_pending = false; resolve_star(false); }
+        if (slash_pending) { slash_pending = false; put('/'); }
+        flush_word();
+        flush_run();
+        end_write(false);
 
         // Ensure "thinking" line is cleared if stream ended abruptly
-        if (in_thinking && !output_callback) {
-            std::cout << "\r\033[K";
+        if (output_callback) return;
+        auto& term = TerminalWriter::out();
+        if (in_thinking) {
+            term.write("\r\033[K");
         }
+        term.color(ANSI_RESET);
+        term.write("\n");
+        term.flush();
 
-        if (!output_callback) std::cout << ANSI_RESET << std::endl;
+        if (std::getenv("LIRA_TERM_STATS")) {
+            const auto st = term.stats();
+            std::cerr << std::format("[term] {} write(2) calls, {} flushes, {} bytes\n", st.syscalls, st.flushes, st.bytes);
+        }
     }
-}
\ No newline at end of file
+}
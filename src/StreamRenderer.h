@@ -1,8 +1,11 @@
 #pragma once
 #include <iostream>
 #include <string>
-#include <set>
+#include <string_view>
 #include <functional> // Added
+#include <vector>
+#include "Syntax.h"
+#include "WriteSink.h"
 
 namespace lira
 {
@@ -14,47 +17,109 @@ namespace lira
         InlineCode,
         CodeBlockStart,
         CodeBlockContent,
+        CodeKeyword,
+        CodeString,
+        CodeComment,
+        CodeNumber,
         CodeBlockEnd,
         Thinking,
         ToolOutput
     };
 
-    using RenderCallback = std::function<void(TokenType, const std::string&)>;
+    // Content views are only valid for the duration of the call
+    using RenderCallback = std::function<void(TokenType, std::string_view)>;
+
+    struct ToolTag {
+        std::string_view opener;
+        std::string_view closer;
+    };
+
+    // Outcome of a <write> tag streamed to disk during generation
+    struct WriteResult {
+        std::string path;
+        size_t bytes = 0;
+        bool ok = false;
+        std::string error;
+    };
 
     class StreamRenderer {
-        // ... (Keep existing bool states) ...
         bool is_first_char = true;
         bool in_gray_block = false;
         bool in_inline_code = false;
         bool in_code_block = false;
         bool awaiting_lang_name = false;
         std::string lang_buffer;
+        const syntax::Language* lang = nullptr; // lexer picked from the fence tag
+        std::string code_specials;              // special_bytes() for plain code
         bool in_string = false;
         char string_char = 0;
+        bool string_escape = false;
         bool in_comment = false;
+        bool in_block_comment = false;
+        char prev_code_char = '\n';
         std::string word_buffer;
         bool hiding_output = false;
-        std::string target_closer;
-        std::string tag_lookahead;
-        std::string format_buffer;
         bool in_thinking = false;
         int think_spinner_idx = 0;
 
+        // Partial-token state carried across chunks (no per-chunk copies)
+        std::string_view target_closer;   // closer of the hidden region we're in
+        size_t closer_matched = 0;        // bytes of target_closer matched so far
+        char tag_buf[16] = {};            // possible tag opener starting with '<'
+        size_t tag_len = 0;
+        int ticks = 0;                    // pending backticks (1 or 2)
+        bool star_pending = false;        // '*' waiting for the next byte
+        bool slash_pending = false;       // '/' in code, maybe a "//" comment
+
+        // <write file="..."> bodies bypass full_response and go straight to disk
+        bool in_write_attrs = false;      // between "<write" and '>'
+        std::string write_attrs;
+        WriteSink write_sink;
+
         RenderCallback output_callback; // The hook
 
+        // Pending run of same-styled characters, emitted as one span
+        std::string run_buffer;
+        TokenType run_type = TokenType::Text;
+
+        void push(TokenType type, std::string_view text);
+        void flush_run();
+        void write_span(TokenType type, std::string_view content);
         void flush_word();
         void render_think_spinner();
 
+        // Tokenizer
+        std::string_view special_bytes() const;
+        bool has_pending_token() const;
+        void consume_plain(const char* p, size_t len);
+        void feed(char c);
+        void put(char c);
+        void feed_tag(char c);
+        void open_tag(const ToolTag& tag);
+        void match_closer(char c);
+        void resolve_ticks();
+        void resolve_star(bool next_is_space);
+        void toggle_fence();
+        void start_comment(std::string_view marker);
+        void start_block_comment();
+        void select_language();
+        bool in_write_body() const;
+        void begin_write();
+        void end_write(bool completed);
+
     public:
         std::string full_response;
         std::string visible_response;
+        std::vector<WriteResult> writes;
+        // Off when re-rendering stored text: <write> bodies are then only hidden
+        bool apply_writes = true;
 
         // Constructor accepts a callback.
         // If nullptr, defaults to std::cout (CLI mode)
         explicit StreamRenderer(RenderCallback callback = nullptr);
-        void emit(TokenType type, const std::string& content);
+        void emit(TokenType type, std::string_view content);
 
-        void print(const std::string& chunk);
-        void finish() const;
+        void print(std::string_view chunk);
+        void finish();
     };
 }
\ No newline at end of file
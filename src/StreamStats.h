@@ -0,0 +1,21 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+namespace lira
+{
+    // Timing of one streamed completion request
+    struct StreamStats {
+        std::chrono::steady_clock::time_point start, first_delta, last_delta, end;
+        size_t deltas = 0;      // content chunks received, roughly tokens
+        long http_status = 0;
+        bool completed = false; // transfer finished without a curl error
+
+        double ttft_ms() const { return deltas ? std::chrono::duration<double, std::milli>(first_delta - start).count() : 0.0; }
+        double total_ms() const { return std::chrono::duration<double, std::milli>(end - start).count(); }
+        double tokens_per_second() const {
+            const double s = std::chrono::duration<double>(end - first_delta).count();
+            return deltas > 1 && s > 0 ? (deltas - 1) / s : 0.0;
+        }
+    };
+}
@@ -0,0 +1,162 @@
+#include "SubAgent.h"
+
+#include <format>
+#include <mutex>
+
+#include "Helpers.h"
+#include "Router.h"
+#include "TextUtil.h"
+#include "WebSearcher.h"
+#include "WorkPool.h"
+
+namespace lira
+{
+    namespace {
+        constexpr int SUBAGENT_ROUNDS = 4;
+        // Cap on what one child adds to the parent conversation
+        constexpr size_t SUBAGENT_REPLY_CHARS = 4000;
+    }
+
+    SubAgent::Result SubAgent::run(const std::string& task, const Options& opt) {
+        trace::Span span("agent", "subagent");
+        span.arg("task", task);
+        Result res;
+        res.task = task;
+        try {
+            const std::string memories = opt.nexus ? opt.nexus->retrieve_relevant(task) : "No memories yet.";
+            const std::string sys_prompt = std::format(
+                "You are a Lira sub-agent. The main agent delegated one task to you; "
+                "other sub-agents work on related tasks in parallel.\n"
+                "- CWD: {}\n"
+                "\n"
+                "=== MEMORY NEXUS (read only) ===\n"
+                "{}\n"
+                "================================\n"
+                "\n"
+                "Tools (Hidden tags):\n"
+                "- <cmd>command</cmd> : Execute shell (bash/zsh).\n"
+                "- <search>query</search> : Google Search. Several tags run in parallel.\n"
+                "- <fetch>url</fetch> : Read the main text of a web page. Several tags run in parallel.\n"
+                "\n"
+                "Work only on your task. Output ONLY the tag to use a tool. When done, reply with a "
+                "concise report of your findings and no tags: the main agent sees only that reply.\n",
+                sanitize_utf8(fs::current_path().string()),
+                memories);
+
+            // The child's messages live and die with its run on this worker
+            std::optional<TurnArena> arena;
+            if (get_turn_arena_enabled()) arena.emplace();
+            turn_json msgs = turn_json::array();
+            msgs.push_back({{"role", "system"}, {"content", sys_prompt}});
+            msgs.push_back({{"role", "user"}, {"content", sanitize_utf8(task)}});
+
+            const auto router = ModelRouter::shared();
+            std::string reply;
+            for (int round = 0; round < SUBAGENT_ROUNDS; ++round) {
+                Route route = router->route(ModelRouter::features(msgs, round > 0));
+                turn_json pl = {
+                    {"model", route.model},
+                    {"messages", std::move(msgs)},
+                    {"stream", true},
+                    {"max_tokens", 2048}
+                };
+
+                // Collected, not shown; children never write files
+                std::optional<StreamRenderer> renderer;
+                for (;;) {
+                    if (opt.request_budget->fetch_sub(1, std::memory_order_relaxed) <= 0) break;
+                    renderer.emplace([](TokenType, std::string_view) {});
+                    renderer->apply_writes = false;
+                    StreamStats stats;
+                    http_post_stream(get_api_url(), pl, opt.api_key, *renderer, &stats);
+                    router->observe(route.model, stats);
+                    res.requests++;
+                    if (!renderer->full_response.empty() || route.model == router->strong_model()) break;
+                    route = router->fallback(route);
+                    pl["model"] = route.model;
+                }
+                msgs = std::move(pl["messages"]);
+                if (!renderer) {
+                    reply += reply.empty() ? "(stopped: request budget used up)" : "\n(stopped: request budget used up)";
+                    break;
+                }
+                if (renderer->full_response.empty()) break;
+
+                const std::string full = renderer->full_response;
+                reply = strip_reasoning(full);
+                msgs.push_back({{"role", "assistant"}, {"content", reply.empty() ? "..." : reply}});
+
+                bool used_tool = false;
+                const auto queries = extract_tags(full, "<search>", "</search>");
+                if (!queries.empty()) {
+                    const std::string result = WebSearcher::format(WebSearcher::search(queries, SearchOptions::from_env()));
+                    msgs.push_back({{"role", "user"}, {"content", "Search Result:\n" + sanitize_utf8(result)}});
+                    used_tool = true;
+                }
+                auto urls = extract_tags(full, "<fetch>", "</fetch>");
+                for (auto& url : urls) {
+                    url.erase(0, url.find_first_not_of(" \t\n"));
+                    url.erase(url.find_last_not_of(" \t\n") + 1);
+                }
+                if (!urls.empty()) {
+                    const auto pages = WebSearcher::fetch(urls, get_fetch_budget(), SearchOptions::from_env());
+                    msgs.push_back({{"role", "user"}, {"content", "Fetch Result:\n" + sanitize_utf8(WebSearcher::format(pages))}});
+                    used_tool = true;
+                }
+                const auto cmds = extract_tags(full, "<cmd>", "</cmd>");
+                if (!cmds.empty()) {
+                    const std::string& cmd = cmds.front();
+                    if (opt.approve_command && opt.approve_command(cmd)) {
+                        msgs.push_back({{"role", "user"}, {"content", "Output:\n" + sanitize_utf8(exec_command(cmd.c_str()))}});
+                    } else {
+                        msgs.push_back({{"role", "user"}, {"content", "User denied."}});
+                    }
+                    used_tool = true;
+                }
+
+                if (!used_tool) {
+                    res.ok = true;
+                    break;
+                }
+            }
+            res.reply = reply;
+        } catch (...) {
+            res.reply = "(sub-agent failed)";
+            res.ok = false;
+        }
+        if (res.reply.size() > SUBAGENT_REPLY_CHARS) res.reply = res.reply.substr(0, SUBAGENT_REPLY_CHARS) + "\n...(truncated)";
+        span.arg("requests", static_cast<double>(res.requests));
+        return res;
+    }
+
+    std::vector<SubAgent::Result> SubAgent::run_all(const std::vector<std::string>& tasks, Options opt) {
+        trace::Span span("agent", "spawn");
+        span.arg("tasks", static_cast<double>(tasks.size()));
+        // Children ask for approval from different workers; one prompt at a time
+        if (opt.approve_command) {
+            opt.approve_command = [approve = std::move(opt.approve_command), mtx = std::make_shared<std::mutex>()](const std::string& cmd) {
+                std::lock_guard lock(*mtx);
+                return approve(cmd);
+            };
+        }
+
+        const auto pool = WorkStealingPool::shared();
+        std::vector<std::future<Result>> pending;
+        pending.reserve(tasks.size());
+        for (const auto& task : tasks) pending.push_back(pool->submit([task, opt] { return run(task, opt); }));
+
+        std::vector<Result> results;
+        results.reserve(tasks.size());
+        for (auto& f : pending) results.push_back(f.get());
+        return results;
+    }
+
+    std::string SubAgent::format(const std::vector<Result>& results) {
+        std::string out = "Sub-agent Results:\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            out += std::format("\n### {}. {}{}\n{}\n", i + 1, r.task, r.ok ? "" : " (incomplete)", r.reply.empty() ? "(no reply)" : r.reply);
+        }
+        return out;
+    }
+}
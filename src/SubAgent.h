@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Nexus.h"
+
+namespace lira
+{
+    // Child agent for one <spawn> task. It has its own message buffer (in a
+    // TurnArena on its worker thread), no session file and no display, and
+    // only reads the Nexus. It runs the cmd/search/fetch tool loop and hands
+    // its final reply back to the parent, which merges all of them into its
+    // conversation as one message.
+    class SubAgent {
+    public:
+        struct Options {
+            std::string api_key;
+            std::shared_ptr<Nexus> nexus;  // read only
+            // Never called concurrently; run_all() serializes approvals
+            std::function<bool(const std::string& cmd)> approve_command;
+            // Model requests left for every sub-agent of the parent's turn
+            std::shared_ptr<std::atomic<long>> request_budget;
+        };
+
+        struct Result {
+            std::string task;
+            std::string reply;
+            size_t requests = 0;
+            bool ok = false;   // finished with an answer, not cut off by errors or the budget
+        };
+
+        // Runs the tasks on WorkStealingPool::shared(); results in task order
+        static std::vector<Result> run_all(const std::vector<std::string>& tasks, Options opt);
+        static Result run(const std::string& task, const Options& opt);
+
+        // One user message with every result, for the parent conversation
+        static std::string format(const std::vector<Result>& results);
+    };
+}
@@ -0,0 +1,109 @@
+#include "Syntax.h"
+#include <algorithm>
+#include <cctype>
+
+namespace lira::syntax
+{
+    // --- Keyword Tables ---
+    constexpr auto GENERIC_KW = make_keyword_table(std::to_array<std::string_view>({
+        "auto", "const", "class", "struct", "int", "void", "string", "bool", "char",
+        "if", "else", "for", "while", "do", "return", "switch", "case", "break",
+        "namespace", "using", "template", "typename", "public", "private", "protected",
+        "import", "from", "def", "lambda", "try", "except", "finally", "with", "as",
+        "var", "let", "function", "async", "await", "echo", "sudo", "cd",
+        "ls", "grep", "cat", "chmod", "chown", "mkdir", "rm", "mv", "cp", "true", "false",
+        "null", "nullptr", "this", "new", "delete", "std", "vector", "map", "set",
+        "gcc", "make", "cmake", "git", "npm", "pip", "docker"
+    }));
+
+    constexpr auto CPP_KW = make_keyword_table(std::to_array<std::string_view>({
+        "alignas", "alignof", "auto", "bool", "break", "case", "catch", "char", "char8_t",
+        "class", "co_await", "co_return", "co_yield", "concept", "const", "consteval",
+        "constexpr", "constinit", "const_cast", "continue", "decltype", "default", "delete",
+        "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern",
+        "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable",
+        "namespace", "new", "noexcept", "nullptr", "operator", "override", "final", "private",
+        "protected", "public", "register", "reinterpret_cast", "requires", "return", "short",
+        "signed", "sizeof", "static", "static_assert", "static_cast", "struct", "switch",
+        "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid",
+        "typename", "union", "unsigned", "using", "virtual", "void", "volatile", "while",
+        "size_t", "int8_t", "int16_t", "int32_t", "int64_t", "uint8_t", "uint16_t",
+        "uint32_t", "uint64_t", "std", "NULL",
+        "#include", "#define", "#undef", "#if", "#ifdef", "#ifndef", "#elif", "#else",
+        "#endif", "#pragma", "#error"
+    }));
+
+    constexpr auto PYTHON_KW = make_keyword_table(std::to_array<std::string_view>({
+        "False", "None", "True", "and", "as", "assert", "async", "await", "break", "class",
+        "continue", "def", "del", "elif", "else", "except", "finally", "for", "from",
+        "global", "if", "import", "in", "is", "lambda", "nonlocal", "not", "or", "pass",
+        "raise", "return", "try", "while", "with", "yield", "match", "case", "self",
+        "print", "len", "range", "int", "str", "float", "list", "dict", "set", "tuple",
+        "bool", "open", "super", "isinstance", "enumerate", "zip"
+    }));
+
+    constexpr auto SHELL_KW = make_keyword_table(std::to_array<std::string_view>({
+        "if", "then", "else", "elif", "fi", "for", "in", "do", "done", "while", "until",
+        "case", "esac", "function", "return", "exit", "export", "local", "readonly",
+        "source", "alias", "unset", "shift", "set", "echo", "printf", "read", "cd", "pwd",
+        "test", "true", "false", "sudo", "ls", "grep", "cat", "chmod", "chown", "mkdir",
+        "rm", "mv", "cp", "ln", "find", "sed", "awk", "curl", "wget", "tar", "git",
+        "make", "cmake", "gcc", "npm", "pip", "docker", "systemctl", "apt", "brew"
+    }));
+
+    constexpr auto JS_KW = make_keyword_table(std::to_array<std::string_view>({
+        "async", "await", "break", "case", "catch", "class", "const", "continue",
+        "debugger", "default", "delete", "do", "else", "export", "extends", "false",
+        "finally", "for", "from", "function", "if", "import", "in", "instanceof", "let",
+        "new", "null", "of", "return", "static", "super", "switch", "this", "throw",
+        "true", "try", "typeof", "undefined", "var", "void", "while", "yield",
+        "interface", "type", "enum", "implements", "private", "public", "protected",
+        "readonly", "abstract", "as", "any", "number", "string", "boolean", "never",
+        "unknown", "console", "require", "module"
+    }));
+
+    constexpr auto RUST_KW = make_keyword_table(std::to_array<std::string_view>({
+        "as", "async", "await", "break", "const", "continue", "crate", "dyn", "else",
+        "enum", "extern", "false", "fn", "for", "if", "impl", "in", "let", "loop", "match",
+        "mod", "move", "mut", "pub", "ref", "return", "self", "Self", "static", "struct",
+        "super", "trait", "true", "type", "unsafe", "use", "where", "while",
+        "i8", "i16", "i32", "i64", "i128", "isize", "u8", "u16", "u32", "u64", "u128",
+        "usize", "f32", "f64", "bool", "char", "str", "String", "Vec", "Option", "Some",
+        "None", "Result", "Ok", "Err", "Box"
+    }));
+
+    // --- Languages ---
+    //                      name          //     /**/   #      #bound #dir   quotes
+    constexpr Language GENERIC    {"generic", true,  false, true,  false, false, "\"'", [](std::string_view w) { return GENERIC_KW.contains(w); }};
+    constexpr Language CPP        {"cpp",     true,  true,  false, false, true,  "\"'", [](std::string_view w) { return CPP_KW.contains(w); }};
+    constexpr Language PYTHON     {"python",  false, false, true,  false, false, "\"'", [](std::string_view w) { return PYTHON_KW.contains(w); }};
+    constexpr Language SHELL      {"shell",   false, false, true,  true,  false, "\"'", [](std::string_view w) { return SHELL_KW.contains(w); }};
+    constexpr Language JAVASCRIPT {"js",      true,  true,  false, false, false, "\"'`", [](std::string_view w) { return JS_KW.contains(w); }};
+    // No '\'' for Rust: lifetimes ('a) would open strings
+    constexpr Language RUST       {"rust",    true,  true,  false, false, false, "\"",  [](std::string_view w) { return RUST_KW.contains(w); }};
+
+    struct Alias { std::string_view tag; const Language* lang; };
+    constexpr Alias ALIASES[] = {
+        {"c", &CPP}, {"cpp", &CPP}, {"c++", &CPP}, {"cc", &CPP}, {"cxx", &CPP}, {"h", &CPP},
+        {"hpp", &CPP}, {"cuda", &CPP}, {"objc", &CPP},
+        {"python", &PYTHON}, {"py", &PYTHON}, {"python3", &PYTHON},
+        {"sh", &SHELL}, {"bash", &SHELL}, {"zsh", &SHELL}, {"shell", &SHELL},
+        {"console", &SHELL}, {"terminal", &SHELL},
+        {"js", &JAVASCRIPT}, {"javascript", &JAVASCRIPT}, {"jsx", &JAVASCRIPT}, {"mjs", &JAVASCRIPT},
+        {"ts", &JAVASCRIPT}, {"typescript", &JAVASCRIPT}, {"tsx", &JAVASCRIPT},
+        {"rust", &RUST}, {"rs", &RUST},
+    };
+
+    const Language& language_for(std::string_view fence_tag) {
+        // "```Python title=x" -> "python"
+        while (!fence_tag.empty() && std::isspace(static_cast<unsigned char>(fence_tag.front()))) fence_tag.remove_prefix(1);
+        fence_tag = fence_tag.substr(0, std::min(fence_tag.find_first_of(" \t\r{"), fence_tag.size()));
+        if (fence_tag.size() > 16) return GENERIC;
+
+        char lower[16];
+        std::ranges::transform(fence_tag, lower, [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+        const std::string_view tag(lower, fence_tag.size());
+        for (const auto& a : ALIASES) if (a.tag == tag) return *a.lang;
+        return GENERIC;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string_view>
+
+namespace lira::syntax
+{
+    // --- Compile-Time Perfect Hash ---
+    // Open-addressed table with 8x headroom; make_keyword_table() searches for a
+    // seed under which no two keywords share a slot. Lookups are one hash and
+    // one string compare, with no allocation.
+    constexpr uint64_t hash_word(std::string_view w, uint64_t seed) {
+        uint64_t h = seed ^ (w.size() * 0x9E3779B97F4A7C15ULL);
+        for (char c : w) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 0x100000001B3ULL;
+        }
+        return h ^ (h >> 29);
+    }
+
+    template<size_t N>
+    struct KeywordTable {
+        static constexpr size_t SLOTS = std::bit_ceil(N) * 8;
+        std::array<std::string_view, SLOTS> slots{};
+        uint64_t seed = 0;
+        size_t max_len = 0;
+
+        constexpr bool contains(std::string_view w) const {
+            if (w.empty() || w.size() > max_len) return false;
+            return slots[hash_word(w, seed) & (SLOTS - 1)] == w;
+        }
+    };
+
+    template<size_t N>
+    consteval KeywordTable<N> make_keyword_table(const std::array<std::string_view, N>& words) {
+        for (uint64_t seed = 1;; ++seed) {
+            KeywordTable<N> t{};
+            t.seed = seed;
+            bool ok = true;
+            for (auto w : words) {
+                auto& slot = t.slots[hash_word(w, seed) & (KeywordTable<N>::SLOTS - 1)];
+                if (!slot.empty()) { ok = false; break; }
+                slot = w;
+                if (w.size() > t.max_len) t.max_len = w.size();
+            }
+            if (ok) return t;
+        }
+    }
+
+    // --- Language Lexer Settings ---
+    struct Language {
+        std::string_view name;
+        bool slash_comments;      // "// ..."
+        bool block_comments;      // "/* ... */"
+        bool hash_comments;       // "# ..."
+        bool hash_needs_boundary; // shell: '#' only starts a comment at a word boundary
+        bool hash_directives;     // C/C++: "#include" is one keyword-colored word
+        std::string_view quotes;  // characters that open a string
+        bool (*is_keyword)(std::string_view);
+    };
+
+    // Resolves a fence tag ("cpp", "py", "bash", ...) to a lexer; unknown tags
+    // get the generic lexer with the old universal keyword list.
+    const Language& language_for(std::string_view fence_tag);
+}
@@ -0,0 +1,107 @@
+#include "TerminalWriter.h"
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <unistd.h>
+
+namespace lira
+{
+    TerminalWriter::TerminalWriter(int fd) : fd(fd) {
+        buffer.reserve(16 * 1024);
+        idle_flusher = std::thread(&TerminalWriter::idle_loop, this);
+    }
+
+    TerminalWriter::~TerminalWriter() {
+        {
+            std::lock_guard lock(mtx);
+            stopping = true;
+            flush_locked();
+        }
+        cv.notify_all();
+        idle_flusher.join();
+    }
+
+    TerminalWriter& TerminalWriter::out() {
+        static TerminalWriter writer(STDOUT_FILENO);
+        return writer;
+    }
+
+    void TerminalWriter::write(std::string_view s) {
+        if (s.empty()) return;
+        std::lock_guard lock(mtx);
+        buffer += s;
+        if (s.find('\n') != std::string_view::npos) pending_newline = true;
+        write_count++;
+        if (flusher_parked) { flusher_parked = false; cv.notify_one(); }
+    }
+
+    void TerminalWriter::color(std::string_view sgr) {
+        std::lock_guard lock(mtx);
+        if (sgr == current_sgr) return;
+        current_sgr = sgr;
+        buffer += sgr;
+    }
+
+    void TerminalWriter::maybe_flush() {
+        std::lock_guard lock(mtx);
+        if (pending_newline || clock::now() - last_flush >= FRAME_INTERVAL) flush_locked();
+    }
+
+    void TerminalWriter::flush() {
+        std::lock_guard lock(mtx);
+        flush_locked();
+    }
+
+    void TerminalWriter::flush_locked() {
+        last_flush = clock::now();
+        pending_newline = false;
+        if (buffer.empty()) return;
+
+        // Anything still sitting in stdio must go out first to keep ordering
+        std::cout.flush();
+        std::fflush(stdout);
+
+        const char* p = buffer.data();
+        size_t left = buffer.size();
+        while (left > 0) {
+            const ssize_t n = ::write(fd, p, left);
+            syscalls.fetch_add(1, std::memory_order_relaxed);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            p += n;
+            left -= static_cast<size_t>(n);
+            bytes.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        }
+        flushes.fetch_add(1, std::memory_order_relaxed);
+        buffer.clear(); // keeps capacity
+    }
+
+    // Pushes out output that has been sitting unflushed once the stream stalls.
+    // Ticks every IDLE_TIMEOUT while output is active and parks when it stops,
+    // so neither streaming nor an idle session costs wakeups per write.
+    void TerminalWriter::idle_loop() {
+        std::unique_lock lock(mtx);
+        uint64_t seen = write_count;
+        int quiet_ticks = 0;
+        while (!stopping) {
+            if (flusher_parked) {
+                cv.wait(lock, [&] { return stopping || !flusher_parked; });
+                seen = write_count;
+                quiet_ticks = 0;
+                continue;
+            }
+            cv.wait_for(lock, IDLE_TIMEOUT);
+            if (write_count == seen) {
+                if (!buffer.empty()) flush_locked();
+                if (++quiet_ticks >= PARK_AFTER_IDLE_TICKS) flusher_parked = true;
+            } else {
+                quiet_ticks = 0;
+            }
+            seen = write_count;
+        }
+    }
+
+    TerminalWriter::Stats TerminalWriter::stats() const {
+        return {syscalls.load(), bytes.load(), flushes.load()};
+    }
+}
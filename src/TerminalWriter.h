@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace lira
+{
+    // Coalescing output layer for the CLI renderer.
+    // Rendered text and ANSI escapes accumulate in one buffer (repeated color
+    // changes dropped) and reach the terminal in a single write(2) per flush:
+    // when a newline was written, when a frame interval has passed, or from a
+    // background timer once output has gone idle.
+    class TerminalWriter {
+    public:
+        struct Stats {
+            uint64_t syscalls = 0;
+            uint64_t bytes = 0;
+            uint64_t flushes = 0;
+        };
+
+        explicit TerminalWriter(int fd);
+        ~TerminalWriter();
+        TerminalWriter(const TerminalWriter&) = delete;
+        TerminalWriter& operator=(const TerminalWriter&) = delete;
+
+        // Shared writer for STDOUT_FILENO
+        static TerminalWriter& out();
+
+        void write(std::string_view s);
+        // Switches SGR state; a no-op if `sgr` is already active
+        void color(std::string_view sgr);
+        // Flushes if the frame interval has passed or a newline is pending
+        void maybe_flush();
+        void flush();
+
+        Stats stats() const;
+
+    private:
+        using clock = std::chrono::steady_clock;
+        static constexpr auto FRAME_INTERVAL = std::chrono::milliseconds(16);
+        static constexpr auto IDLE_TIMEOUT = std::chrono::milliseconds(30);
+        static constexpr int PARK_AFTER_IDLE_TICKS = 32; // ~1s without output
+
+        int fd;
+        mutable std::mutex mtx;
+        std::condition_variable cv;
+        std::string buffer;
+        std::string current_sgr;
+        bool pending_newline = false;
+        clock::time_point last_flush = clock::now();
+        uint64_t write_count = 0;           // lets the idle timer see whether output moved
+        bool flusher_parked = true;         // idle timer sleeps untimed until output resumes
+        bool stopping = false;
+        std::thread idle_flusher;
+
+        std::atomic<uint64_t> syscalls{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> flushes{0};
+
+        void flush_locked();
+        void idle_loop();
+    };
+}
@@ -0,0 +1,65 @@
+#include "TextUtil.h"
+#include <regex>
+
+namespace lira
+{
+    // --- Helper: Strip Reasoning ---
+    std::string strip_reasoning(const std::string& input) {
+        std::regex think_regex(R"(<think>[\s\S]*?</think>)");
+        return std::regex_replace(input, think_regex, "");
+    }
+
+    // --- Helper: Force Valid UTF-8 ---
+    // Replaces invalid bytes with '?' to prevent JSON crashes
+    std::string sanitize_utf8(const std::string& str) {
+        std::string result;
+        result.reserve(str.size());
+
+        for (size_t i = 0; i < str.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(str[i]);
+            if (c < 0x80) {
+                // ASCII (0xxxxxxx)
+                result += c;
+            } else {
+                // Check Multibyte
+                int len = 0;
+                if ((c & 0xE0) == 0xC0) len = 2; // 110xxxxx
+                else if ((c & 0xF0) == 0xE0) len = 3; // 1110xxxx
+                else if ((c & 0xF8) == 0xF0) len = 4; // 11110xxx
+
+                bool valid = (len > 0) && (i + len <= str.size());
+                if (valid) {
+                    for (int j = 1; j < len; ++j) {
+                        if ((static_cast<unsigned char>(str[i + j]) & 0xC0) != 0x80) {
+                            valid = false;
+                            break;
+                        }
+                    }
+                }
+
+                if (valid) {
+                    for (int j = 0; j < len; ++j) result += str[i + j];
+                    i += (len - 1);
+                } else {
+                    // Invalid byte found, replace with placeholder
+                    result += '?';
+                }
+            }
+        }
+        return result;
+    }
+
+    // --- Helper: Tool Tags ---
+    std::vector<std::string> extract_tags(const std::string& text, std::string_view open, std::string_view close) {
+        std::vector<std::string> out;
+        for (size_t pos = 0;;) {
+            const auto start = text.find(open, pos);
+            if (start == std::string::npos) break;
+            const auto end = text.find(close, start + open.size());
+            if (end == std::string::npos) break;
+            out.push_back(text.substr(start + open.size(), end - (start + open.size())));
+            pos = end + close.size();
+        }
+        return out;
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lira
+{
+    // Removes <think>...</think> blocks before a reply goes into history
+    std::string strip_reasoning(const std::string& input);
+    // Replaces invalid UTF-8 bytes with '?' so the JSON payload stays valid
+    std::string sanitize_utf8(const std::string& str);
+    // Contents of every complete open...close pair, in order
+    std::vector<std::string> extract_tags(const std::string& text, std::string_view open, std::string_view close);
+}
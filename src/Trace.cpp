@@ -0,0 +1,183 @@
+#include "Trace.h"
+
+#ifndef LIRA_NO_TRACE
+#include <algorithm>
+#include <cstdio>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+
+namespace lira::trace
+{
+    namespace
+    {
+        struct Event {
+            const char* cat;
+            const char* name;
+            char phase;          // 'X' complete, 'i' instant
+            int64_t ts_ns;       // since the trace epoch
+            int64_t dur_ns;
+            std::string args;    // `"k":v,...` without braces
+        };
+
+        // Per-thread buffer; the thread's own lock is only contended by flush()
+        struct ThreadBuffer {
+            std::mutex mtx;
+            std::vector<Event> events;
+            uint32_t tid = 0;
+            std::string name;
+            bool named = false;  // thread_name metadata written
+        };
+
+        // Flush once a thread has this many events pending
+        constexpr size_t FLUSH_EVENTS = 8192;
+
+        struct Writer {
+            std::mutex mtx;
+            std::FILE* out = nullptr;
+            bool failed = false;
+            bool first = true;
+            uint32_t next_tid = 1;
+            std::vector<std::shared_ptr<ThreadBuffer>> threads;
+            const clock::time_point epoch = clock::now();
+            const int pid = static_cast<int>(getpid());
+
+            // The closing bracket is written at exit; a truncated file (crash)
+            // is still accepted by the trace viewers
+            bool open_locked() {
+                if (out || failed) return out != nullptr;
+                const char* path = std::getenv("LIRA_TRACE");
+                out = std::fopen(path, "w");
+                if (!out) { failed = true; return false; }
+                std::fputs("[\n", out);
+                const std::string meta = std::format(R"({{"name":"process_name","ph":"M","pid":{},"tid":0,"args":{{"name":"lira"}}}})", pid);
+                write_locked(meta);
+                return true;
+            }
+
+            void write_locked(const std::string& line) {
+                if (!first) std::fputs(",\n", out);
+                std::fputs(line.c_str(), out);
+                first = false;
+            }
+        };
+
+        // Leaked so thread-local buffers and the exit hook can outlive static destruction
+        Writer& writer() {
+            static Writer* w = [] {
+                auto* p = new Writer;
+                std::atexit([] {
+                    flush();
+                    Writer& wr = writer();
+                    std::lock_guard lock(wr.mtx);
+                    if (wr.out) {
+                        std::fputs("\n]\n", wr.out);
+                        std::fclose(wr.out);
+                        wr.out = nullptr;
+                        wr.failed = true;  // no reopening from late spans
+                    }
+                });
+                return p;
+            }();
+            return *w;
+        }
+
+        ThreadBuffer& local() {
+            thread_local std::shared_ptr<ThreadBuffer> buf = [] {
+                auto b = std::make_shared<ThreadBuffer>();
+                Writer& w = writer();
+                std::lock_guard lock(w.mtx);
+                b->tid = w.next_tid++;
+                b->name = gettid() == w.pid ? "main" : std::format("thread {}", b->tid);
+                w.threads.push_back(b);
+                return b;
+            }();
+            return *buf;
+        }
+
+        int64_t since_epoch(clock::time_point t) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(t - writer().epoch).count();
+        }
+
+        void push(Event e) {
+            ThreadBuffer& b = local();
+            size_t pending;
+            {
+                std::lock_guard lock(b.mtx);
+                b.events.push_back(std::move(e));
+                pending = b.events.size();
+            }
+            if (pending >= FLUSH_EVENTS) flush();
+        }
+    }
+
+    void record(const char* cat, const char* name, clock::time_point start, clock::time_point end, std::string args) {
+        if (!enabled()) return;
+        const int64_t ts = since_epoch(start);
+        push({cat, name, 'X', ts, std::max<int64_t>(0, since_epoch(end) - ts), std::move(args)});
+    }
+
+    void instant(const char* cat, const char* name, std::string args) {
+        if (!enabled()) return;
+        push({cat, name, 'i', since_epoch(clock::now()), 0, std::move(args)});
+    }
+
+    void set_thread_name(const std::string& name) {
+        if (!enabled()) return;
+        ThreadBuffer& b = local();
+        std::lock_guard lock(b.mtx);
+        b.name = name;
+        b.named = false;
+    }
+
+    void append_arg(std::string& args, std::string_view key, std::string_view value) {
+        if (!args.empty()) args += ',';
+        args += nlohmann::json(key).dump();
+        args += ':';
+        args += nlohmann::json(value).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    }
+
+    void append_arg(std::string& args, std::string_view key, double value) {
+        if (!args.empty()) args += ',';
+        args += nlohmann::json(key).dump();
+        args += std::format(":{}", value);
+    }
+
+    void flush() {
+        if (!enabled()) return;
+        Writer& w = writer();
+        std::lock_guard lock(w.mtx);
+        if (!w.open_locked()) return;
+
+        std::vector<Event> events;
+        for (auto it = w.threads.begin(); it != w.threads.end();) {
+            ThreadBuffer& b = **it;
+            {
+                std::lock_guard block(b.mtx);
+                events.swap(b.events);
+                if (!b.named) {
+                    w.write_locked(std::format(R"({{"name":"thread_name","ph":"M","pid":{},"tid":{},"args":{{"name":{}}}}})",
+                        w.pid, b.tid, nlohmann::json(b.name).dump()));
+                    b.named = true;
+                }
+            }
+            for (const auto& e : events) {
+                std::string line = std::format(R"({{"name":"{}","cat":"{}","ph":"{}","ts":{:.3f},"pid":{},"tid":{})",
+                    e.name, e.cat, e.phase, e.ts_ns / 1e3, w.pid, b.tid);
+                if (e.phase == 'X') line += std::format(R"(,"dur":{:.3f})", e.dur_ns / 1e3);
+                else line += R"(,"s":"t")";
+                if (!e.args.empty()) line += R"(,"args":{)" + e.args + "}";
+                line += '}';
+                w.write_locked(line);
+            }
+            events.clear();
+            // Buffers of finished threads are only referenced from here
+            it = it->use_count() == 1 ? w.threads.erase(it) : it + 1;
+        }
+        std::fflush(w.out);
+    }
+}
+#endif
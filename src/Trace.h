@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+// Span tracing for the turn pipeline. With LIRA_TRACE=<file> set, spans are
+// buffered per thread and appended to <file> as Chrome trace-event JSON
+// (open it in ui.perfetto.dev or chrome://tracing). When unset a span costs
+// one branch; building with LIRA_NO_TRACE compiles every call away.
+namespace lira::trace
+{
+    using clock = std::chrono::steady_clock;
+
+#ifndef LIRA_NO_TRACE
+    inline bool enabled() {
+        static const bool on = [] {
+            const char* path = std::getenv("LIRA_TRACE");
+            return path && *path;
+        }();
+        return on;
+    }
+
+    // A finished span, for phases only known after the fact (e.g. curl timings)
+    void record(const char* cat, const char* name, clock::time_point start, clock::time_point end, std::string args = {});
+    void instant(const char* cat, const char* name, std::string args = {});
+    // Appends buffered events to the trace file; also runs at exit
+    void flush();
+    void set_thread_name(const std::string& name);
+
+    // Appends `"key": value` to a span's argument list
+    void append_arg(std::string& args, std::string_view key, std::string_view value);
+    void append_arg(std::string& args, std::string_view key, double value);
+
+    // Records [construction, destruction) on the current thread. `cat` and
+    // `name` must be string literals.
+    class Span {
+        const char* cat;
+        const char* name;
+        clock::time_point start;
+        std::string args;
+        bool active;
+
+    public:
+        Span(const char* cat, const char* name) : cat(cat), name(name), active(enabled()) {
+            if (active) start = clock::now();
+        }
+        ~Span() { end(); }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        // Guard expensive argument formatting with `if (span)`
+        explicit operator bool() const { return active; }
+        void arg(std::string_view key, std::string_view value) { if (active) append_arg(args, key, value); }
+        void arg(std::string_view key, double value) { if (active) append_arg(args, key, value); }
+
+        // Closes the span before the end of its scope
+        void end() {
+            if (active) record(cat, name, start, clock::now(), std::move(args));
+            active = false;
+        }
+    };
+#else
+    constexpr bool enabled() { return false; }
+    inline void record(const char*, const char*, clock::time_point, clock::time_point, std::string = {}) {}
+    inline void instant(const char*, const char*, std::string = {}) {}
+    inline void flush() {}
+    inline void set_thread_name(const std::string&) {}
+    inline void append_arg(std::string&, std::string_view, std::string_view) {}
+    inline void append_arg(std::string&, std::string_view, double) {}
+
+    class Span {
+    public:
+        Span(const char*, const char*) {}
+        explicit operator bool() const { return false; }
+        void arg(std::string_view, std::string_view) {}
+        void arg(std::string_view, double) {}
+        void end() {}
+    };
+#endif
+}
@@ -2,114 +2,532 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
-#include <regex>
+#include <list>
+#include <memory>
+#include <unordered_set>
 #include <curl/curl.h>
-#include <vector>
+#include "Helpers.h"
+#include "Html.h"
+#include "SearchCache.h"
 
 namespace lira {
 
-    size_t WebSearcher::WriteCallback(void* contents, size_t size, size_t nmemb, std::string* s) {
-        size_t newLength = size * nmemb;
-        try { s->append(static_cast<char*>(contents), newLength); } catch(...) { return 0; }
-        return newLength;
-    }
+    // --- Result Extraction ---
+    // In gbv=1 every visible text block is a <div class="BNeawe ...">; the
+    // second class says what it is. Titles and display URLs sit inside the
+    // result link (<a href="/url?q=TARGET&sa=...">), the snippet follows it.
+    namespace {
+        enum class BlockKind { Title, DisplayUrl, Snippet, Other };
 
-    std::string WebSearcher::url_encode(const std::string &value) {
-        std::ostringstream escaped;
-        escaped.fill('0'); escaped << std::hex;
-        for (char c : value) {
-            if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') escaped << c;
-            else { escaped << std::uppercase; escaped << '%' << std::setw(2) << static_cast<int>(static_cast<unsigned char>(c)); escaped << std::nouppercase; }
+        BlockKind classify(std::string_view cls) {
+            if (cls.find("vvjwJb") != std::string_view::npos) return BlockKind::Title;
+            if (cls.find("UPmit") != std::string_view::npos) return BlockKind::DisplayUrl;
+            if (cls.find("s3v9rd") != std::string_view::npos) return BlockKind::Snippet;
+            return BlockKind::Other;
         }
-        return escaped.str();
-    }
 
-    std::string WebSearcher::perform_search(const std::string& query) {
-        std::cout << "\033[1;34m[Searching Google: " << query << "...]\033[0m" << std::endl;
+        int hex_value(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
 
-        CURL* curl = curl_easy_init();
-        std::string buffer;
+        // "/url?q=https%3A%2F%2Fx.com%2F&sa=U" -> "https://x.com/"; plain
+        // http(s) links outside Google are taken as they are
+        std::string result_target(std::string_view href) {
+            constexpr std::string_view redirect = "/url?q=";
+            if (href.starts_with(redirect)) {
+                href.remove_prefix(redirect.size());
+                href = href.substr(0, href.find('&'));
+                std::string out;
+                out.reserve(href.size());
+                for (size_t i = 0; i < href.size(); ++i) {
+                    int hi, lo;
+                    if (href[i] == '%' && i + 2 < href.size() && (hi = hex_value(href[i + 1])) >= 0 && (lo = hex_value(href[i + 2])) >= 0) {
+                        out += static_cast<char>(hi * 16 + lo);
+                        i += 2;
+                    } else {
+                        out += href[i];
+                    }
+                }
+                return out;
+            }
+            if ((href.starts_with("http://") || href.starts_with("https://")) && href.find(".google.") == std::string_view::npos) {
+                return std::string(href);
+            }
+            return {};
+        }
 
-        if(curl) {
-            // Google Basic Version (gbv=1) - Legacy HTML, no JS, very stable structure
-            // hl=en forces English results
-            // num=5 limits results to 5
-            std::string url = "https://www.google.com/search?q=" + url_encode(query) + "&gbv=1&hl=en&num=5";
+        class ResultExtractor : public html::Sink {
+            size_t max_results;
+            int div_depth = 0;
+            int block_depth = -1;      // depth of the BNeawe div being captured
+            BlockKind block_kind = BlockKind::Other;
+            std::string block;         // whitespace-collapsed text of that div
+            std::string link;          // target of the enclosing result link
+            bool in_link = false;
 
-            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+        public:
+            html::Tokenizer* tokenizer = nullptr;
+            std::vector<SearchResult> results;
+            std::vector<std::string> blocks; // every non-empty block, for the fallback
 
-            // Generic Chrome User Agent to avoid immediate 403
-            curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36");
+            explicit ResultExtractor(size_t max) : max_results(max) {}
 
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-            curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+            void on_open(const html::Tag& tag) override {
+                if (tag.name == "div") {
+                    if (tag.self_closing) return;
+                    ++div_depth;
+                    const std::string_view cls = tag.attr("class");
+                    if (block_depth < 0 && cls.starts_with("BNeawe")) {
+                        block_depth = div_depth;
+                        block_kind = classify(cls);
+                        block.clear();
+                    }
+                } else if (tag.name == "a") {
+                    in_link = true;
+                    link = result_target(tag.attr("href"));
+                } else if (block_depth >= 0 && (tag.name == "br" || tag.name == "p" || tag.name == "li")) {
+                    on_text(" ");
+                }
+            }
 
-            // Important: Google checks referrers sometimes
-            curl_easy_setopt(curl, CURLOPT_REFERER, "https://www.google.com/");
+            void on_close(std::string_view name) override {
+                if (name == "a") {
+                    in_link = false;
+                } else if (name == "div" && div_depth > 0) {
+                    if (div_depth-- == block_depth) end_block();
+                }
+            }
+
+            void on_text(std::string_view text) override {
+                if (block_depth < 0) return;
+                for (char c : text) {
+                    const bool space = c == ' ' || c == '\n' || c == '\t' || c == '\r';
+                    if (!space) block += c;
+                    else if (!block.empty() && block.back() != ' ') block += ' ';
+                }
+            }
+
+        private:
+            void end_block() {
+                block_depth = -1;
+                if (!block.empty() && block.back() == ' ') block.pop_back();
+                if (block.empty()) return;
+                blocks.push_back(block);
+
+                switch (block_kind) {
+                case BlockKind::Title:
+                    if (!in_link || link.empty()) return;
+                    if (results.size() == max_results) {
+                        // A further result started: everything needed is in
+                        if (tokenizer) tokenizer->stop();
+                        return;
+                    }
+                    results.push_back({std::move(block), link, {}, {}});
+                    break;
+                case BlockKind::DisplayUrl:
+                    if (!results.empty() && results.back().url.empty()) results.back().url = std::move(block);
+                    break;
+                case BlockKind::Snippet:
+                    // Related-search chips are snippet-styled links; skip them
+                    if (!in_link && !results.empty() && results.back().snippet.empty()) results.back().snippet = std::move(block);
+                    break;
+                case BlockKind::Other:
+                    break;
+                }
+            }
+        };
+
+        // --- Fetch Pipeline ---
+        constexpr size_t MAX_SEARCH_PAGE = 4 << 20;
+        constexpr const char* USER_AGENT = "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36";
 
-            CURLcode res = curl_easy_perform(curl);
-            curl_easy_cleanup(curl);
+        struct Transfer {
+            enum class Kind { Search, Page } kind;
+            size_t query = 0;                           // search: index into the batch
+            FetchedPage* page = nullptr;                // page: where the text goes
+            CURL* easy = nullptr;
+            std::string body;                           // search page
+            std::unique_ptr<html::TextCollector> text;  // result page, reduced as it arrives
+            std::unique_ptr<html::Tokenizer> tokenizer;
+            bool checked_type = false;
+            bool plain_text = false;
 
-            if(res != CURLE_OK) return "Error: Network request failed.";
+            Transfer(Kind kind, size_t query, FetchedPage* page = nullptr) : kind(kind), query(query), page(page) {}
+        };
+
+        // One marker per finished transfer; they overlap, so no spans
+        void trace_transfer(CURL* easy, const Transfer& t, long status) {
+            const char* url = nullptr;
+            curl_off_t total = 0;
+            curl_easy_getinfo(easy, CURLINFO_EFFECTIVE_URL, &url);
+            curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total);
+            std::string args;
+            trace::append_arg(args, "url", url ? url : "");
+            trace::append_arg(args, "status", static_cast<double>(status));
+            trace::append_arg(args, "ms", total / 1e3);
+            trace::instant("websearch", t.kind == Transfer::Kind::Search ? "search_done" : "page_done", std::move(args));
         }
 
-        if(buffer.empty()) return "Error: Empty response.";
+        size_t search_write(char* data, size_t size, size_t nmemb, void* user) {
+            auto* t = static_cast<Transfer*>(user);
+            const size_t n = size * nmemb;
+            if (t->body.size() + n > MAX_SEARCH_PAGE) return 0;
+            try { t->body.append(data, n); } catch(...) { return 0; }
+            return n;
+        }
 
-        // --- Parsing Google Basic HTML ---
-        // In gbv=1, main results text is often inside <div class="BNeawe ...">
-        // We capture the text content of these divs.
+        // Pages are never buffered whole: each chunk goes through the tokenizer
+        // and the transfer is aborted once the text budget is reached
+        size_t page_write(char* data, size_t size, size_t nmemb, void* user) {
+            auto* t = static_cast<Transfer*>(user);
+            const size_t n = size * nmemb;
+            if (!t->checked_type) {
+                t->checked_type = true;
+                char* type = nullptr;
+                curl_easy_getinfo(t->easy, CURLINFO_CONTENT_TYPE, &type);
+                const std::string_view ct = type ? type : "text/html";
+                if (ct.find("html") == std::string_view::npos) {
+                    if (!ct.starts_with("text/")) {
+                        t->page->error = "Error: Unsupported content type " + std::string(ct) + ".";
+                        return 0; // PDFs, images, ...
+                    }
+                    t->plain_text = true;
+                }
+            }
+            try {
+                if (t->plain_text) t->text->on_text({data, n});
+                else t->tokenizer->feed({data, n});
+            } catch(...) { return 0; }
+            return t->text->truncated ? 0 : n;
+        }
 
-        std::string results_text = "Search Results for: " + query + "\n\n";
-        int count = 0;
+        CURL* make_easy(const std::string& url, Transfer& t, long timeout_ms) {
+            CURL* curl = curl_easy_init();
+            if (!curl) return nullptr;
+            t.easy = curl;
+            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, t.kind == Transfer::Kind::Search ? search_write : page_write);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &t);
+            curl_easy_setopt(curl, CURLOPT_PRIVATE, &t);
+            // Generic Chrome User Agent to avoid immediate 403
+            curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
+            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+            curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+            curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+            // Important: Google checks referrers sometimes
+            if (t.kind == Transfer::Kind::Search) curl_easy_setopt(curl, CURLOPT_REFERER, "https://www.google.com/");
+            return curl;
+        }
 
-        // Regex to find the specific Google Basic class "BNeawe"
-        // This class wraps Titles (s3v9rd) and Snippets.
-        std::regex snippet_regex(R"(<div class="BNeawe[^>]*>(.*?)</div>)");
+        // Transfers on one curl multi handle, sharing a deadline
+        class Batch {
+            using clock = std::chrono::steady_clock;
+            const SearchOptions& options;
+            size_t page_budget;
+            clock::time_point deadline;
+            CURLM* multi;
+            std::list<Transfer> transfers; // stable addresses for CURLOPT_PRIVATE
 
-        auto begin = std::sregex_iterator(buffer.begin(), buffer.end(), snippet_regex);
-        auto end = std::sregex_iterator();
+            long remaining_ms() const {
+                return std::max<long>(1, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count());
+            }
+
+            void start(Transfer t, const std::string& url) {
+                Transfer& added = transfers.emplace_back(std::move(t));
+                if (added.kind == Transfer::Kind::Page) {
+                    added.text = std::make_unique<html::TextCollector>(page_budget);
+                    added.tokenizer = std::make_unique<html::Tokenizer>(*added.text);
+                    added.text->attach(*added.tokenizer);
+                }
+                CURL* easy = make_easy(url, added, remaining_ms());
+                if (!easy || curl_multi_add_handle(multi, easy) != CURLM_OK) {
+                    if (easy) curl_easy_cleanup(easy);
+                    if (added.page) added.page->error = "Error: Network request failed.";
+                    transfers.pop_back();
+                }
+            }
+
+            static void finish_page(Transfer& t, bool partial) {
+                if (!t.plain_text) t.tokenizer->finish();
+                t.page->text = t.text->take();
+                t.page->partial = partial || t.text->truncated;
+                char* effective = nullptr;
+                if (curl_easy_getinfo(t.easy, CURLINFO_EFFECTIVE_URL, &effective) == CURLE_OK && effective) t.page->url = effective;
+            }
+
+        public:
+            Batch(const SearchOptions& o, size_t budget)
+                : options(o), page_budget(budget), deadline(clock::now() + o.deadline), multi(curl_multi_init()) {
+                if (multi) curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, options.max_host_connections);
+            }
+
+            ~Batch() {
+                for (auto& t : transfers) {
+                    curl_multi_remove_handle(multi, t.easy);
+                    curl_easy_cleanup(t.easy);
+                }
+                if (multi) curl_multi_cleanup(multi);
+            }
+
+            bool ok() const { return multi != nullptr; }
+
+            void add_search(size_t query, const std::string& url) { start(Transfer(Transfer::Kind::Search, query), url); }
+
+            void add_page(FetchedPage& page) {
+                if (!page.url.starts_with("http://") && !page.url.starts_with("https://")) {
+                    page.error = "Error: Only http(s) URLs can be fetched.";
+                    return;
+                }
+                start(Transfer(Transfer::Kind::Page, 0, &page), page.url);
+            }
 
-        std::vector<std::string> clean_hits;
+            // Runs until every transfer is done or the deadline passes. Finished
+            // searches go to `on_search(query, code, status, body)`, which may add pages.
+            // Whatever is still running at the deadline is abandoned; pages keep
+            // the text they already had.
+            template<class F>
+            std::vector<size_t> run(F&& on_search) {
+                trace::Span span("websearch", "batch");
+                span.arg("transfers", static_cast<double>(transfers.size()));
+                int running = 0;
+                while (!transfers.empty()) {
+                    curl_multi_perform(multi, &running);
 
-        for (std::sregex_iterator i = begin; i != end; ++i) {
-            std::smatch match = *i;
-            std::string text = match.str(1);
+                    int left = 0;
+                    while (CURLMsg* msg = curl_multi_info_read(multi, &left)) {
+                        if (msg->msg != CURLMSG_DONE) continue;
+                        Transfer* t = nullptr;
+                        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &t);
+                        const CURLcode res = msg->data.result;
+                        long status = 0;
+                        curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &status);
+                        if (span) trace_transfer(msg->easy_handle, *t, status);
 
-            // Cleanup HTML tags
-            text = std::regex_replace(text, std::regex(R"(<[^>]*>)"), "");
+                        if (t->kind == Transfer::Kind::Search) {
+                            on_search(t->query, res, status, t->body);
+                        } else if (status < 400 && (res == CURLE_OK || t->text->truncated)) {
+                            // A write error here is our own abort at the text budget
+                            finish_page(*t, false);
+                        } else if (res == CURLE_OPERATION_TIMEDOUT) {
+                            // curl's timeout is the batch deadline
+                            if (!t->text->empty()) finish_page(*t, true);
+                            else t->page->error = "Error: Timed out.";
+                        } else if (t->page->error.empty()) {
+                            t->page->error = status >= 400 ? std::format("Error: HTTP {}.", status) : "Error: Network request failed.";
+                        }
 
-            // Cleanup Entities
-            text = std::regex_replace(text, std::regex(R"(&nbsp;)"), " ");
-            text = std::regex_replace(text, std::regex(R"(&amp;)"), "&");
-            text = std::regex_replace(text, std::regex(R"(&quot;)"), "\"");
-            text = std::regex_replace(text, std::regex(R"(&#39;)"), "'");
-            text = std::regex_replace(text, std::regex(R"(&lt;)"), "<");
-            text = std::regex_replace(text, std::regex(R"(&gt;)"), ">");
+                        curl_multi_remove_handle(multi, msg->easy_handle);
+                        curl_easy_cleanup(msg->easy_handle);
+                        transfers.remove_if([t](const Transfer& x) { return &x == t; });
+                    }
 
-            // Filter out navigation noise (Google puts "Web Images..." in these divs too)
+                    if (transfers.empty() || clock::now() >= deadline) break;
+                    curl_multi_poll(multi, nullptr, 0, static_cast<int>(std::min(remaining_ms(), 1000L)), nullptr);
+                }
+
+                std::vector<size_t> timed_out;
+                for (auto& t : transfers) {
+                    if (t.kind == Transfer::Kind::Search) timed_out.push_back(t.query);
+                    else if (!t.text->empty()) finish_page(t, true);
+                    else t.page->error = "Error: Timed out.";
+                }
+                return timed_out;
+            }
+        };
+
+        // Cache entries hold the parsed results so cached queries can still fetch pages
+        std::string results_to_json(const std::vector<SearchResult>& results) {
+            json arr = json::array();
+            for (const auto& r : results) arr.push_back({{"title", r.title}, {"url", r.url}, {"snippet", r.snippet}});
+            return arr.dump();
+        }
+
+        bool results_from_json(const std::string& text, std::vector<SearchResult>& out) {
+            try {
+                const json arr = json::parse(text);
+                for (const auto& r : arr) out.push_back({r.value("title", ""), r.value("url", ""), r.value("snippet", ""), {}});
+            } catch (...) {
+                out.clear();
+                return false;
+            }
+            return !out.empty();
+        }
+    }
+
+    SearchOptions SearchOptions::from_env() {
+        SearchOptions o;
+        o.endpoint = get_search_endpoint();
+        o.fetch_pages = get_search_fetch_pages();
+        o.max_host_connections = get_search_host_connections();
+        o.deadline = std::chrono::milliseconds(get_search_deadline_ms());
+        o.use_cache = get_search_cache_ttl() > 0;
+        return o;
+    }
+
+    std::string WebSearcher::url_encode(const std::string &value) {
+        std::ostringstream escaped;
+        escaped.fill('0'); escaped << std::hex;
+        for (char c : value) {
+            if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') escaped << c;
+            else { escaped << std::uppercase; escaped << '%' << std::setw(2) << static_cast<int>(static_cast<unsigned char>(c)); escaped << std::nouppercase; }
+        }
+        return escaped.str();
+    }
+
+    std::vector<SearchResult> WebSearcher::parse_results(std::string_view html, size_t max_results) {
+        trace::Span span("websearch", "parse_results");
+        ResultExtractor extractor(max_results);
+        html::Tokenizer tokenizer(extractor);
+        extractor.tokenizer = &tokenizer;
+        tokenizer.feed(html);
+        tokenizer.finish();
+        if (!extractor.results.empty()) return std::move(extractor.results);
+
+        // Unfamiliar layout: fall back to any block that looks like prose,
+        // filtering out navigation noise ("Web Images...", settings links)
+        std::vector<SearchResult> fallback;
+        std::unordered_set<std::string_view> seen;
+        for (const auto& text : extractor.blocks) {
             if (text.length() < 15) continue;
             if (text.find("Google Home") != std::string::npos) continue;
             if (text.find("Settings") != std::string::npos) continue;
+            if (!seen.insert(text).second) continue;
+            fallback.push_back({{}, {}, text, {}});
+            if (fallback.size() >= max_results) break;
+        }
+        return fallback;
+    }
+
+    std::string WebSearcher::format_results(const std::string& query, const std::vector<SearchResult>& results) {
+        if (results.empty()) return "No readable results. Google might be blocking automated requests.";
 
-            // Deduplicate (Title and Snippet often repeat parts)
-            bool duplicate = false;
-            for(const auto& h : clean_hits) {
-                if (h == text || text.find(h) != std::string::npos) { duplicate = true; break; }
+        std::string results_text = "Search Results for: " + query + "\n\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            results_text += std::format("[{}] {}\n", i + 1, r.title.empty() ? r.snippet : r.title);
+            if (!r.url.empty()) results_text += "    " + r.url + "\n";
+            if (!r.title.empty() && !r.snippet.empty()) results_text += "    " + r.snippet + "\n";
+            if (r.page.text.empty()) continue;
+            results_text += r.page.partial ? "    Page (excerpt):\n" : "    Page:\n";
+            std::string_view rest = r.page.text;
+            while (!rest.empty()) {
+                const size_t nl = rest.find('\n');
+                if (const auto line = rest.substr(0, nl); !line.empty()) results_text += std::format("      {}\n", line);
+                if (nl == std::string_view::npos) break;
+                rest.remove_prefix(nl + 1);
             }
-            if(duplicate) continue;
+        }
+        return results_text;
+    }
+
+    std::string WebSearcher::format(const std::vector<QueryResults>& batch) {
+        std::string out;
+        for (const auto& q : batch) {
+            if (!out.empty()) out += "\n";
+            if (!q.error.empty()) out += batch.size() > 1 ? "Search for \"" + q.query + "\": " + q.error + "\n" : q.error;
+            else out += format_results(q.query, q.results);
+        }
+        return out;
+    }
 
-            clean_hits.push_back(text);
-            results_text += std::format("[{}] {}\n", count + 1, text);
-            count++;
+    // --- Concurrent Search ---
+    std::vector<QueryResults> WebSearcher::search(const std::vector<std::string>& queries, const SearchOptions& options) {
+        trace::Span span("websearch", "search");
+        span.arg("queries", static_cast<double>(queries.size()));
+        std::vector<QueryResults> out(queries.size());
+        auto cache = options.use_cache ? SearchCache::shared() : nullptr;
 
-            if(count >= 5) break;
+        Batch batch(options, options.page_text_budget);
+        if (!batch.ok()) {
+            for (size_t q = 0; q < queries.size(); ++q) out[q] = {queries[q], {}, "Error: Network request failed."};
+            return out;
         }
+        auto queue_pages = [&](size_t q) {
+            auto& results = out[q].results;
+            for (size_t r = 0; r < std::min(options.fetch_pages, results.size()); ++r) {
+                results[r].page.url = results[r].url;
+                batch.add_page(results[r].page);
+            }
+        };
 
-        if (count == 0) return "No readable results. Google might be blocking automated requests.";
+        for (size_t q = 0; q < queries.size(); ++q) {
+            out[q].query = queries[q];
+            if (cache) {
+                if (auto hit = cache->lookup(queries[q]); hit && results_from_json(hit->result, out[q].results)) {
+                    out[q].cached = true;
+                    trace::instant("websearch", hit->stale ? "cache_stale" : "cache_hit");
+                    // Serve the expired copy now; one process refreshes it in the background
+                    if (hit->stale && cache->begin_revalidate(queries[q])) {
+                        SearchOptions refresh = options;
+                        refresh.fetch_pages = 0;
+                        refresh.use_cache = false;
+                        cache->revalidate_async(queries[q], [query = queries[q], refresh] {
+                            const auto fresh = search({query}, refresh);
+                            return fresh[0].results.empty() ? std::string() : results_to_json(fresh[0].results);
+                        });
+                    }
+                    queue_pages(q);
+                    continue;
+                }
+            }
+            batch.add_search(q, options.endpoint + "?q=" + url_encode(queries[q]) + std::format("&gbv=1&hl=en&num={}", options.max_results));
+        }
 
-        return results_text;
+        const auto timed_out = batch.run([&](size_t qi, CURLcode res, long status, const std::string& body) {
+            auto& q = out[qi];
+            if (res == CURLE_OPERATION_TIMEDOUT) q.error = "Error: Search timed out.";
+            else if (res != CURLE_OK || status >= 400) q.error = "Error: Network request failed.";
+            else if (body.empty()) q.error = "Error: Empty response.";
+            else q.results = parse_results(body, options.max_results);
+            if (q.error.empty() && q.results.empty()) q.error = "No readable results. Google might be blocking automated requests.";
+            if (!q.results.empty()) {
+                if (cache) cache->store(q.query, results_to_json(q.results));
+                queue_pages(qi);
+            }
+        });
+        for (size_t q : timed_out) out[q].error = "Error: Search timed out.";
+        return out;
+    }
+
+    // --- Page Fetch ---
+    std::vector<FetchedPage> WebSearcher::fetch(const std::vector<std::string>& urls, size_t text_budget, const SearchOptions& options) {
+        trace::Span span("websearch", "fetch");
+        span.arg("urls", static_cast<double>(urls.size()));
+        std::vector<FetchedPage> pages(urls.size());
+        Batch batch(options, text_budget);
+        for (size_t i = 0; i < urls.size(); ++i) {
+            pages[i].url = urls[i];
+            if (!batch.ok()) pages[i].error = "Error: Network request failed.";
+            else batch.add_page(pages[i]);
+        }
+        if (batch.ok()) batch.run([](size_t, CURLcode, long, const std::string&) {});
+
+        for (auto& p : pages) {
+            if (p.text.empty() && p.error.empty()) p.error = "Error: No readable text.";
+        }
+        return pages;
+    }
+
+    std::string WebSearcher::format(const std::vector<FetchedPage>& pages) {
+        std::string out;
+        for (const auto& p : pages) {
+            if (!out.empty()) out += "\n\n";
+            out += "Page: " + p.url + "\n";
+            if (!p.error.empty()) { out += p.error; continue; }
+            out += "\n" + p.text;
+            if (p.partial) out += std::format("\n[truncated at {} bytes]", p.text.size());
+        }
+        return out;
+    }
+
+    std::string WebSearcher::perform_search(const std::string& query) {
+        std::cout << "\033[1;34m[Searching Google: " << query << "...]\033[0m" << std::endl;
+        return format(search({query}, SearchOptions::from_env()));
     }
 
-} // namespace lira
\ No newline at end of file
+} // namespace lira
@@ -3,14 +3,64 @@
 //
 
 #pragma once
+#include <chrono>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace lira
 {
+    struct FetchedPage {
+        std::string url;
+        std::string text;         // readable main text
+        bool partial = false;     // cut off by the text budget or the deadline
+        std::string error;
+    };
+
+    struct SearchResult {
+        std::string title;
+        std::string url;
+        std::string snippet;
+        FetchedPage page;         // filled when result pages are fetched
+    };
+
+    struct QueryResults {
+        std::string query;
+        std::vector<SearchResult> results;
+        std::string error;        // set when no results came back
+        bool cached = false;
+    };
+
+    struct SearchOptions {
+        std::string endpoint;                 // search page URL, the query is appended as ?q=
+        size_t max_results = 5;
+        size_t fetch_pages = 0;               // top-N result pages fetched per query
+        size_t page_text_budget = 4000;       // bytes of text kept per page
+        long max_host_connections = 2;
+        std::chrono::milliseconds deadline{10000};
+        bool use_cache = true;
+
+        // Defaults overridden by LIRA_SEARCH_* environment variables
+        static SearchOptions from_env();
+    };
+
     class WebSearcher {
-        static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* s);
         static std::string url_encode(const std::string &value);
     public:
+        // Extracts results from a Google basic-HTML (gbv=1) page in a single pass
+        static std::vector<SearchResult> parse_results(std::string_view html, size_t max_results = 5);
+        static std::string format_results(const std::string& query, const std::vector<SearchResult>& results);
+
+        // Runs all queries concurrently, then fetches the top result pages, all
+        // within one deadline. Whatever finished by then is returned, in query order.
+        static std::vector<QueryResults> search(const std::vector<std::string>& queries, const SearchOptions& options);
+        static std::string format(const std::vector<QueryResults>& batch);
+
+        // Fetches pages concurrently and keeps only their main text, at most
+        // `text_budget` bytes each; transfers stop once the budget is reached
+        static std::vector<FetchedPage> fetch(const std::vector<std::string>& urls, size_t text_budget, const SearchOptions& options);
+        static std::string format(const std::vector<FetchedPage>& pages);
+
         static std::string perform_search(const std::string& query);
     };
 }
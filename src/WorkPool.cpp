@@ -0,0 +1,80 @@
+#include "WorkPool.h"
+
+#include <format>
+
+#include "Helpers.h"
+
+namespace lira
+{
+    WorkStealingPool::WorkStealingPool(size_t workers) {
+        workers = std::max<size_t>(1, workers);
+        for (size_t i = 0; i < workers; ++i) queues.push_back(std::make_unique<Queue>());
+        // Queues first: a worker may steal from any of them as soon as it starts
+        for (size_t i = 0; i < workers; ++i) threads.emplace_back([this, i] { worker(i); });
+    }
+
+    WorkStealingPool::~WorkStealingPool() {
+        {
+            std::lock_guard lock(idle_mtx);
+            stopping = true;
+        }
+        idle_cv.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    std::shared_ptr<WorkStealingPool> WorkStealingPool::shared() {
+        static std::shared_ptr<WorkStealingPool> instance = std::make_shared<WorkStealingPool>(get_spawn_workers());
+        return instance;
+    }
+
+    void WorkStealingPool::push(Task task) {
+        const size_t target = current == this ? current_index : next.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        {
+            std::lock_guard lock(queues[target]->mtx);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        pending.fetch_add(1, std::memory_order_release);
+        // Taking the lock orders this against a worker checking `pending` before it sleeps
+        { std::lock_guard lock(idle_mtx); }
+        idle_cv.notify_one();
+    }
+
+    bool WorkStealingPool::run_one(size_t self) {
+        Task task;
+        {
+            // Own deque: newest first, its data is most likely still in cache
+            Queue& own = *queues[self];
+            std::lock_guard lock(own.mtx);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+            }
+        }
+        for (size_t i = 1; !task && i < queues.size(); ++i) {
+            // Others: oldest first, the end their owner isn't working on
+            Queue& victim = *queues[(self + i) % queues.size()];
+            std::lock_guard lock(victim.mtx);
+            if (victim.tasks.empty()) continue;
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (!task) return false;
+        pending.fetch_sub(1, std::memory_order_relaxed);
+        task();  // packaged_task keeps exceptions for the future
+        executed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void WorkStealingPool::worker(size_t self) {
+        current = this;
+        current_index = self;
+        trace::set_thread_name(std::format("pool worker {}", self));
+        for (;;) {
+            if (run_one(self)) continue;
+            std::unique_lock lock(idle_mtx);
+            idle_cv.wait(lock, [this] { return stopping || pending.load(std::memory_order_acquire) > 0; });
+            if (stopping && pending.load(std::memory_order_acquire) == 0) return;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace lira
+{
+    // Fixed set of worker threads, each with its own task deque. A worker
+    // runs its newest task first and, when its deque is empty, steals the
+    // oldest task of another worker, so long and short tasks even out
+    // without a shared queue every worker contends on. Tasks submitted from
+    // outside the pool are dealt round-robin; tasks submitted by a worker go
+    // to its own deque.
+    //
+    // A task must not wait on another task of the same pool: with every
+    // worker waiting nothing would be left to run them.
+    class WorkStealingPool {
+    public:
+        struct Stats {
+            uint64_t executed = 0;
+            uint64_t stolen = 0;   // taken from another worker's deque
+        };
+
+        explicit WorkStealingPool(size_t workers);
+        // Runs what is still queued, then joins
+        ~WorkStealingPool();
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        // get_spawn_workers() threads, started on first use
+        static std::shared_ptr<WorkStealingPool> shared();
+
+        template<class F>
+        auto submit(F&& fn) -> std::future<std::invoke_result_t<std::decay_t<F>&>> {
+            using R = std::invoke_result_t<std::decay_t<F>&>;
+            std::packaged_task<R()> task(std::forward<F>(fn));
+            auto result = task.get_future();
+            push(Task(std::move(task)));
+            return result;
+        }
+
+        size_t size() const { return queues.size(); }
+        Stats stats() const { return {executed.load(std::memory_order_relaxed), stolen.load(std::memory_order_relaxed)}; }
+
+    private:
+        using Task = std::move_only_function<void()>;
+
+        struct Queue {
+            std::mutex mtx;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;  // one per worker
+        std::vector<std::thread> threads;
+
+        // Idle workers sleep here until something is pushed
+        std::mutex idle_mtx;
+        std::condition_variable idle_cv;
+        bool stopping = false;                 // guarded by idle_mtx
+        std::atomic<size_t> pending{0};        // queued, not yet taken
+        std::atomic<size_t> next{0};           // round-robin for outside submits
+        std::atomic<uint64_t> executed{0};
+        std::atomic<uint64_t> stolen{0};
+
+        void push(Task task);
+        bool run_one(size_t self);
+        void worker(size_t self);
+
+        static inline thread_local const WorkStealingPool* current = nullptr;
+        static inline thread_local size_t current_index = 0;
+    };
+}
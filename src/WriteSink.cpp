@@ -0,0 +1,161 @@
+#include "WriteSink.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lira
+{
+    static bool is_ws(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    WriteSink::~WriteSink() {
+        if (is_open()) abort();
+    }
+
+    bool WriteSink::open(const std::string& target) {
+        if (is_open()) abort();
+        path = target;
+        phase = Phase::Leading;
+        fenced = false;
+        held.clear();
+        out_buf.clear();
+        out_buf.reserve(OUT_BUF_SIZE);
+        written = 0;
+        failed = false;
+
+        // Temp file in the target's directory so the final rename stays atomic
+        const std::filesystem::path p(target);
+        const std::filesystem::path dir = p.parent_path().empty() ? "." : p.parent_path();
+        std::string tmpl = (dir / ("." + p.filename().string() + ".lira-XXXXXX")).string();
+        std::vector<char> buf(tmpl.begin(), tmpl.end());
+        buf.push_back('\0');
+        fd = mkstemp(buf.data());
+        if (fd < 0) return false;
+        tmp_path = buf.data();
+
+        // Keep the mode of a file we're replacing, otherwise a regular 0644
+        struct stat st{};
+        fchmod(fd, stat(target.c_str(), &st) == 0 ? (st.st_mode & 07777) : 0644);
+        return true;
+    }
+
+    // --- Incremental Fence Stripping ---
+    void WriteSink::write(std::string_view data) {
+        if (!is_open()) return;
+        size_t i = 0;
+        while (i < data.size() && phase != Phase::Body) {
+            const char c = data[i];
+            switch (phase) {
+            case Phase::Leading:
+                if (is_ws(c)) { ++i; break; }
+                phase = (c == '`') ? Phase::FenceOpen : Phase::Body;
+                break;
+            case Phase::FenceOpen:
+                if (c == '`') {
+                    held += c; ++i;
+                    if (held.size() == 3) { fenced = true; held.clear(); phase = Phase::FenceHeader; }
+                    break;
+                }
+                // One or two backticks are just content
+                phase = Phase::Body;
+                { const std::string ticks = std::move(held); held.clear(); emit_body(ticks); }
+                break;
+            case Phase::FenceHeader:
+                // Skip the language tag line
+                ++i;
+                if (c == '\n') phase = Phase::LeadingAfterFence;
+                break;
+            case Phase::LeadingAfterFence:
+                if (is_ws(c)) { ++i; break; }
+                phase = Phase::Body;
+                break;
+            case Phase::Body:
+                break;
+            }
+        }
+        if (i < data.size()) emit_body(data.substr(i));
+    }
+
+    // Writes everything except a trailing part that may still turn out to be
+    // whitespace or the closing fence
+    void WriteSink::emit_body(std::string_view data) {
+        size_t keep = data.size();
+        while (keep > 0 && is_ws(data[keep - 1])) --keep;
+        if (fenced) {
+            size_t t = keep;
+            int ticks = 0;
+            while (t > 0 && data[t - 1] == '`' && ticks < 3) { --t; ++ticks; }
+            if (ticks > 0) {
+                keep = t;
+                while (keep > 0 && is_ws(data[keep - 1])) --keep;
+            }
+        }
+        if (keep == 0) { held.append(data); return; }
+
+        out_buf += held;
+        out_buf.append(data.substr(0, keep));
+        held.assign(data.substr(keep));
+        if (out_buf.size() >= OUT_BUF_SIZE) flush_out();
+    }
+
+    void WriteSink::flush_out() {
+        const char* p = out_buf.data();
+        size_t left = out_buf.size();
+        while (left > 0 && !failed) {
+            const ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) { failed = true; break; }
+            p += n; left -= static_cast<size_t>(n); written += static_cast<size_t>(n);
+        }
+        out_buf.clear(); // keeps capacity
+    }
+
+    bool WriteSink::commit(std::string& error) {
+        if (!is_open()) { error = "no file open"; return false; }
+
+        // Resolve the undecided tail: drop trailing whitespace and closing fence
+        if (phase == Phase::FenceOpen) { phase = Phase::Body; held.clear(); }
+        if (phase == Phase::Body) {
+            std::string_view tail = held;
+            while (!tail.empty() && is_ws(tail.back())) tail.remove_suffix(1);
+            if (fenced && tail.ends_with("```")) tail.remove_suffix(3);
+            while (!tail.empty() && is_ws(tail.back())) tail.remove_suffix(1);
+            out_buf.append(tail);
+        }
+        held.clear();
+        flush_out();
+        // Data must be on disk before the rename, or a crash can leave an
+        // empty file in place of the original
+        if (!failed && ::fsync(fd) != 0) failed = true;
+
+        const int err = failed ? errno : 0;
+        ::close(fd);
+        fd = -1;
+        if (failed) {
+            ::unlink(tmp_path.c_str());
+            error = std::strerror(err);
+            return false;
+        }
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            error = std::strerror(errno);
+            ::unlink(tmp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void WriteSink::abort() {
+        if (!is_open()) return;
+        ::close(fd);
+        fd = -1;
+        ::unlink(tmp_path.c_str());
+        held.clear();
+        out_buf.clear();
+    }
+}
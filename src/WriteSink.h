@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace lira
+{
+    // Streams the body of a <write file="..."> tag to disk while it is generated.
+    // Content goes to a temp file next to the target and is renamed over it on
+    // commit(). A leading ``` fence line, a trailing ``` and surrounding
+    // whitespace are stripped on the fly; memory use is bounded by the output
+    // buffer plus whatever trailing whitespace/fence is still undecided.
+    class WriteSink {
+        enum class Phase { Leading, FenceOpen, FenceHeader, LeadingAfterFence, Body };
+
+        int fd = -1;
+        std::string path;
+        std::string tmp_path;
+        Phase phase = Phase::Leading;
+        bool fenced = false;
+        std::string held;     // undecided bytes: opening backticks or trailing ws/fence
+        std::string out_buf;  // batched output, flushed at OUT_BUF_SIZE
+        size_t written = 0;
+        bool failed = false;
+
+        void emit_body(std::string_view data);
+        void flush_out();
+
+    public:
+        static constexpr size_t OUT_BUF_SIZE = 64 * 1024;
+
+        WriteSink() = default;
+        ~WriteSink();
+        WriteSink(const WriteSink&) = delete;
+        WriteSink& operator=(const WriteSink&) = delete;
+
+        bool open(const std::string& target);
+        void write(std::string_view data);
+        // Flushes and fsyncs, then atomically replaces the target. Returns false and fills `error` on failure.
+        bool commit(std::string& error);
+        void abort();
+
+        bool is_open() const { return fd >= 0; }
+        const std::string& target() const { return path; }
+        size_t bytes_written() const { return written; }
+    };
+}
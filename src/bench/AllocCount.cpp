@@ -0,0 +1,32 @@
+#include "AllocCount.h"
+#include <cstdlib>
+#include <new>
+
+// Out of line, so callers never see new paired with free (-Wmismatched-new-delete).
+// The array and nothrow forms forward to these by default.
+namespace lira::bench
+{
+    thread_local size_t heap_allocations = 0;
+    thread_local size_t heap_bytes = 0;
+}
+
+void* operator new(std::size_t n) {
+    lira::bench::heap_allocations++;
+    lira::bench::heap_bytes += n;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n, std::align_val_t al) {
+    lira::bench::heap_allocations++;
+    lira::bench::heap_bytes += n;
+    const auto align = static_cast<std::size_t>(al);
+    // aligned_alloc wants a multiple of the alignment
+    if (void* p = std::aligned_alloc(align, ((n ? n : 1) + align - 1) & ~(align - 1))) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
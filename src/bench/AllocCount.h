@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+
+// Global heap allocations per thread, counted by the operator new/delete
+// replacements in AllocCount.cpp; link that file into the binary. Per thread
+// so the in-process mock servers don't show up in the agent's numbers.
+namespace lira::bench
+{
+    extern thread_local size_t heap_allocations;
+    extern thread_local size_t heap_bytes;
+}
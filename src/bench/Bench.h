@@ -0,0 +1,129 @@
+#pragma once
+#include <chrono>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+
+// Minimal micro-benchmark harness for lira_bench.
+// Each case runs until it has accumulated `min_seconds` of wall time.
+namespace lira::bench
+{
+    struct Result {
+        std::string name;
+        size_t iterations = 0;
+        size_t bytes = 0;   // bytes processed across all iterations (0: not a throughput case)
+        double seconds = 0;
+        std::vector<std::pair<std::string, double>> metrics; // case-specific extras
+    };
+
+    struct Config {
+        std::string filter;       // only cases whose name contains this
+        double time_scale = 1.0;  // --quick shortens every case
+    };
+
+    inline Config& config() {
+        static Config c;
+        return c;
+    }
+
+    // Deque: references handed out by run() stay valid
+    inline std::deque<Result>& results() {
+        static std::deque<Result> r;
+        return r;
+    }
+
+    inline bool selected(const std::string& name) {
+        return config().filter.empty() || name.find(config().filter) != std::string::npos;
+    }
+
+    template<class F>
+    Result& run(const std::string& name, size_t bytes_per_iter, F&& fn, double min_seconds = 0.5) {
+        using clock = std::chrono::steady_clock;
+        fn(); // warm-up
+        Result r;
+        r.name = name;
+        const auto start = clock::now();
+        do {
+            fn();
+            r.iterations++;
+            r.seconds = std::chrono::duration<double>(clock::now() - start).count();
+        } while (r.seconds < min_seconds * config().time_scale);
+        r.bytes = bytes_per_iter * r.iterations;
+
+        if (r.bytes) {
+            std::cerr << std::format("{:<40} {:>10.2f} MB/s {:>12.0f} it/s\n",
+                name, r.bytes / r.seconds / 1e6, r.iterations / r.seconds);
+        } else {
+            std::cerr << std::format("{:<40} {:>10.0f} ns/it {:>11.0f} it/s\n",
+                name, r.seconds / r.iterations * 1e9, r.iterations / r.seconds);
+        }
+        results().push_back(std::move(r));
+        return results().back();
+    }
+
+    // Records an extra figure for a case and prints it under the case line
+    inline void metric(Result& r, const std::string& key, double value) {
+        r.metrics.emplace_back(key, value);
+        std::cerr << std::format("{:<40} {:>10.1f} {}\n", "", value, key);
+    }
+
+    inline std::string load_fixture(const std::string& name) {
+        std::ifstream f(std::string(LIRA_BENCH_FIXTURES) + "/" + name, std::ios::binary);
+        if (!f) { std::cerr << "Missing fixture: " << name << std::endl; std::exit(1); }
+        std::stringstream ss;
+        ss << f.rdbuf();
+        return ss.str();
+    }
+
+    // Splits text into SSE-delta sized pieces (3..9 bytes) like a real stream
+    inline std::vector<std::string> chunk(const std::string& text) {
+        std::vector<std::string> out;
+        size_t step = 3;
+        for (size_t i = 0; i < text.size(); i += step, step = 3 + (i % 7)) {
+            out.push_back(text.substr(i, step));
+        }
+        return out;
+    }
+
+    // Machine-readable results for tracking over time
+    inline bool write_json(const std::string& path) {
+        nlohmann::json cases = nlohmann::json::array();
+        for (const auto& r : results()) {
+            nlohmann::json c = {
+                {"name", r.name},
+                {"iterations", r.iterations},
+                {"seconds", r.seconds},
+                {"ns_per_iter", r.iterations ? r.seconds / r.iterations * 1e9 : 0.0},
+            };
+            if (r.bytes) c["mb_per_s"] = r.bytes / r.seconds / 1e6;
+            for (const auto& [k, v] : r.metrics) c["metrics"][k] = v;
+            cases.push_back(std::move(c));
+        }
+        char host[256] = {};
+        gethostname(host, sizeof(host) - 1);
+        const nlohmann::json doc = {
+            {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()},
+            {"host", host},
+            {"compiler", __VERSION__},
+#ifdef NDEBUG
+            {"optimized", true},
+#else
+            {"optimized", false},
+#endif
+            {"time_scale", config().time_scale},
+            {"results", cases},
+        };
+        if (path == "-") { std::cout << doc.dump(2) << std::endl; return true; }
+        std::ofstream f(path);
+        if (!f) return false;
+        f << doc.dump(2) << "\n";
+        return f.good();
+    }
+}
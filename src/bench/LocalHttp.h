@@ -0,0 +1,180 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <format>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Local stand-in for remote HTTP servers: canned responses on 127.0.0.1
+// with per-route latency, one thread per connection, Connection: close.
+// Handlers can instead write the response themselves (e.g. an SSE stream).
+namespace lira::bench
+{
+    class LocalHttpServer {
+    public:
+        struct Route {
+            std::string body;
+            std::string content_type = "text/html; charset=utf-8";
+            int delay_ms = 0;   // before the response is sent
+            int status = 200;
+        };
+
+        struct Request {
+            std::string method;
+            std::string path;
+            std::string body;
+        };
+        // Writes raw response bytes; false once the client has gone away
+        using Writer = std::function<bool(std::string_view)>;
+        using Handler = std::function<void(const Request&, const Writer&)>;
+
+        // Port 0 picks a free one
+        explicit LocalHttpServer(int port = 0) {
+            listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+            const int one = 1;
+            setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(static_cast<uint16_t>(port));
+            if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                close(listen_fd);
+                listen_fd = -1;
+                return;
+            }
+            socklen_t len = sizeof(addr);
+            getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+            bound_port = ntohs(addr.sin_port);
+            listen(listen_fd, 64);
+            acceptor = std::thread([this] { accept_loop(); });
+        }
+
+        ~LocalHttpServer() {
+            stopping = true;
+            if (listen_fd < 0) return;
+            shutdown(listen_fd, SHUT_RDWR);
+            close(listen_fd);
+            acceptor.join();
+            std::lock_guard lock(mtx);
+            for (auto& t : workers) t.join();
+        }
+
+        // Requests are matched against the longest registered path prefix
+        void route(const std::string& prefix, Route r) {
+            std::lock_guard lock(mtx);
+            routes[prefix] = std::move(r);
+        }
+
+        void handle(const std::string& prefix, Handler h) {
+            std::lock_guard lock(mtx);
+            handlers[prefix] = std::move(h);
+        }
+
+        bool listening() const { return bound_port != 0; }
+        std::string url(const std::string& path) const { return std::format("http://127.0.0.1:{}{}", bound_port, path); }
+        int port() const { return bound_port; }
+        // Most connections that were open at the same time
+        int peak_connections() const { return peak; }
+        void reset_peak() { peak = active.load(); }
+
+    private:
+        int listen_fd = -1;
+        int bound_port = 0;
+        std::atomic<bool> stopping{false};
+        std::atomic<int> active{0};
+        std::atomic<int> peak{0};
+        std::thread acceptor;
+        std::mutex mtx;
+        std::vector<std::thread> workers;
+        std::map<std::string, Route> routes;
+        std::map<std::string, Handler> handlers;
+
+        void accept_loop() {
+            while (!stopping) {
+                const int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd < 0) continue;
+                std::lock_guard lock(mtx);
+                workers.emplace_back([this, fd] { serve(fd); });
+            }
+        }
+
+        void serve(int fd) {
+            const int now = ++active;
+            for (int p = peak; now > p && !peak.compare_exchange_weak(p, now);) {}
+
+            std::string request;
+            char buf[4096];
+            size_t head_end;
+            while ((head_end = request.find("\r\n\r\n")) == std::string::npos) {
+                const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0) break;
+                request.append(buf, static_cast<size_t>(n));
+            }
+            Request req;
+            const size_t sp1 = request.find(' ');
+            const size_t sp2 = request.find(' ', sp1 + 1);
+            if (sp1 != std::string::npos && sp2 != std::string::npos) {
+                req.method = request.substr(0, sp1);
+                req.path = request.substr(sp1 + 1, sp2 - sp1 - 1);
+            } else {
+                req.path = "/";
+            }
+            if (head_end != std::string::npos) {
+                // Body: Content-Length only, which is all curl sends for POSTFIELDS
+                size_t length = 0;
+                std::string head = request.substr(0, head_end);
+                std::ranges::transform(head, head.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                if (const size_t cl = head.find("\r\ncontent-length:"); cl != std::string::npos) {
+                    try { length = std::stoul(head.substr(cl + 17)); } catch (...) {}
+                }
+                req.body = request.substr(head_end + 4);
+                while (req.body.size() < length) {
+                    const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                    if (n <= 0) break;
+                    req.body.append(buf, static_cast<size_t>(n));
+                }
+            }
+
+            const Writer write = [fd](std::string_view data) {
+                for (size_t off = 0; off < data.size();) {
+                    const ssize_t n = send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+                    if (n <= 0) return false;
+                    off += static_cast<size_t>(n);
+                }
+                return true;
+            };
+
+            Route r{"not found", "text/plain", 0, 404};
+            Handler handler;
+            {
+                std::lock_guard lock(mtx);
+                size_t best = 0;
+                for (const auto& [prefix, route] : routes) {
+                    if (req.path.starts_with(prefix) && prefix.size() >= best) { best = prefix.size(); r = route; }
+                }
+                for (const auto& [prefix, h] : handlers) {
+                    if (req.path.starts_with(prefix) && prefix.size() >= best) { best = prefix.size(); handler = h; }
+                }
+            }
+            if (handler) {
+                handler(req, write);
+            } else {
+                if (r.delay_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(r.delay_ms));
+                write(std::format("HTTP/1.1 {} X\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n",
+                    r.status, r.content_type, r.body.size()) + r.body);
+            }
+            --active;
+            close(fd);
+        }
+    };
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "LocalHttp.h"
+
+// Offline stand-in for the OpenRouter chat completions endpoint. Streams
+// replies as SSE at a set token rate after a first-token delay, can fail
+// every Nth request, and picks replies from a script keyed on the last
+// message, so tool round trips (<cmd> -> "Output:" -> answer) replay too.
+namespace lira::bench
+{
+    struct MockStep {
+        std::string when;  // substring of the last message; empty matches anything
+        std::string reply;
+    };
+
+    struct MockConfig {
+        double tokens_per_second = 200;  // 0: as fast as the socket takes it
+        int first_token_ms = 200;
+        size_t chars_per_token = 4;
+
+        enum class Error { Http500, Http429, Disconnect, ErrorEvent };
+        size_t error_every = 0;          // fail every Nth request (0: never)
+        Error error = Error::Http500;
+
+        std::vector<MockStep> script;    // first matching step wins
+        std::string reply = "This is a reply from the mock server.";
+        std::string replay;              // recorded SSE stream, replaces the reply when no step matches
+    };
+
+    class MockOpenRouter {
+    public:
+        explicit MockOpenRouter(MockConfig c, int port = 0) : server(port), config(std::move(c)) {
+            server.handle("/api/v1/chat/completions", [this](const LocalHttpServer::Request& req, const LocalHttpServer::Writer& write) {
+                serve(req, write);
+            });
+        }
+
+        bool listening() const { return server.listening(); }
+        std::string endpoint() const { return server.url("/api/v1/chat/completions"); }
+        size_t requests() const { return request_count; }
+
+    private:
+        LocalHttpServer server;
+        MockConfig config;
+        std::atomic<size_t> request_count{0};
+
+        using clock = std::chrono::steady_clock;
+
+        static std::string chunk(const nlohmann::json& delta, const nlohmann::json& finish = nullptr) {
+            const nlohmann::json j = {
+                {"id", "gen-mock"}, {"provider", "Mock"}, {"model", "mock/model"},
+                {"object", "chat.completion.chunk"}, {"created", 0},
+                {"choices", {{{"index", 0}, {"delta", delta}, {"finish_reason", finish}}}},
+            };
+            return "data: " + j.dump() + "\n\n";
+        }
+
+        // The first script step whose trigger occurs in the last message of `body`
+        const MockStep* match(const std::string& body) const {
+            std::string last;
+            try {
+                const auto j = nlohmann::json::parse(body);
+                if (!j["messages"].empty()) last = j["messages"].back().value("content", "");
+            } catch (...) {}
+            for (const auto& step : config.script) {
+                if (step.when.empty() || last.find(step.when) != std::string::npos) return &step;
+            }
+            return nullptr;
+        }
+
+        // Splits the reply into token-sized pieces without cutting UTF-8 sequences
+        std::vector<std::string> tokens(const std::string& text) const {
+            std::vector<std::string> out;
+            size_t i = 0;
+            while (i < text.size()) {
+                size_t end = std::min(text.size(), i + std::max<size_t>(1, config.chars_per_token));
+                while (end < text.size() && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) ++end;
+                out.push_back(text.substr(i, end - i));
+                i = end;
+            }
+            return out;
+        }
+
+        // Sends SSE events paced at the token rate; false if the client left
+        bool pace(const std::vector<std::string>& events, const LocalHttpServer::Writer& write, size_t stop_after = SIZE_MAX) const {
+            const auto start = clock::now();
+            for (size_t i = 0; i < events.size() && i < stop_after; ++i) {
+                if (config.tokens_per_second > 0) {
+                    std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(
+                        std::chrono::duration<double>(i / config.tokens_per_second)));
+                }
+                if (!write(events[i])) return false;
+            }
+            return true;
+        }
+
+        void serve(const LocalHttpServer::Request& req, const LocalHttpServer::Writer& write) {
+            const size_t n = ++request_count;
+            const bool fail = config.error_every && n % config.error_every == 0;
+
+            if (fail && (config.error == MockConfig::Error::Http500 || config.error == MockConfig::Error::Http429)) {
+                const int status = config.error == MockConfig::Error::Http500 ? 500 : 429;
+                const std::string body = std::format(R"({{"error":{{"message":"{}","code":{}}}}})",
+                    status == 500 ? "Internal Server Error" : "Rate limit exceeded", status);
+                write(std::format("HTTP/1.1 {} X\r\nContent-Type: application/json\r\nContent-Length: {}\r\nConnection: close\r\n\r\n",
+                    status, body.size()) + body);
+                return;
+            }
+
+            std::vector<std::string> events;
+            const MockStep* step = match(req.body);
+            if (!step && !config.replay.empty()) {
+                // Every "data:" event of the recording, keep-alive comments dropped
+                for (size_t pos = 0; pos < config.replay.size();) {
+                    size_t end = config.replay.find("\n\n", pos);
+                    if (end == std::string::npos) end = config.replay.size();
+                    if (config.replay.compare(pos, 6, "data: ") == 0) events.push_back(config.replay.substr(pos, end - pos) + "\n\n");
+                    pos = end + 2;
+                }
+            } else {
+                events.push_back(chunk({{"role", "assistant"}, {"content", ""}}));
+                for (const auto& t : tokens(step ? step->reply : config.reply)) events.push_back(chunk({{"role", "assistant"}, {"content", t}}));
+                events.push_back(chunk({{"role", "assistant"}, {"content", ""}}, "stop"));
+                events.push_back("data: [DONE]\n\n");
+            }
+
+            if (!write("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n")) return;
+            // OpenRouter sends keep-alive comments while the provider warms up
+            write(": OPENROUTER PROCESSING\n\n");
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.first_token_ms));
+
+            if (!fail) {
+                pace(events, write);
+                return;
+            }
+            // Mid-stream failures after half the reply
+            if (!pace(events, write, events.size() / 2)) return;
+            if (config.error == MockConfig::Error::ErrorEvent) {
+                write(R"(data: {"error":{"message":"Provider returned error","code":502},"choices":[{"index":0,"delta":{"content":""},"finish_reason":"error"}]})" "\n\n");
+            }
+            // Disconnect: the connection just closes
+        }
+    };
+}
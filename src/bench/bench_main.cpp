@@ -0,0 +1,470 @@
+#include "AllocCount.h"
+#include "Bench.h"
+#include "LocalHttp.h"
+#include "Helpers.h"
+#include "Html.h"
+#include "Metrics.h"
+#include "Nexus.h"
+#include "Router.h"
+#include "StreamRenderer.h"
+#include "TerminalWriter.h"
+#include "TextUtil.h"
+#include "WebSearcher.h"
+#include "WorkPool.h"
+#include <cstring>
+#include <optional>
+#include <random>
+#include <regex>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace lira;
+
+// Behaviour the numbers depend on; a failed check makes lira_bench exit 1
+static int failed_checks = 0;
+static void check(bool ok, const std::string& what) {
+    if (ok) return;
+    std::cerr << "CHECK FAILED: " << what << std::endl;
+    failed_checks++;
+}
+
+// --- StreamRenderer ---
+// Replays a recorded assistant response in SSE-sized chunks through both
+// output paths. Throughput is reported in characters of model output.
+static void bench_renderer() {
+    std::string response;
+    const std::string recorded = bench::load_fixture("long_response.md");
+    for (int i = 0; i < 8; ++i) response += recorded + "\n\n";
+    const auto chunks = bench::chunk(response);
+
+    // CLI path: real ANSI formatting and terminal writes, with stdout on /dev/null
+    std::cout.flush();
+    const int saved_stdout = dup(STDOUT_FILENO);
+    const int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    const auto before = TerminalWriter::out().stats();
+    auto& r = bench::run("renderer/cli", response.size(), [&] {
+        StreamRenderer renderer;
+        for (const auto& c : chunks) renderer.print(c);
+        renderer.finish();
+    });
+    const auto after = TerminalWriter::out().stats();
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(devnull);
+    close(saved_stdout);
+    const double iters = r.iterations + 1.0; // + warm-up
+    bench::metric(r, "write_syscalls_per_response", (after.syscalls - before.syscalls) / iters);
+    bench::metric(r, "terminal_bytes_per_response", (after.bytes - before.bytes) / iters);
+
+    // Callback path: what the GUI receives
+    size_t sink = 0;
+    bench::run("renderer/callback", response.size(), [&] {
+        StreamRenderer r([&](TokenType, std::string_view s) { sink += s.size(); });
+        for (const auto& c : chunks) r.print(c);
+        r.finish();
+    });
+    check(sink > 0, "renderer/callback produced no output");
+}
+
+// --- SSE Stream ---
+// A recorded OpenRouter completion stream fed to StreamCallback in
+// network-sized reads, rendered through the callback path. Covers line
+// splitting, JSON parsing of every delta and the renderer behind it.
+static void bench_sse() {
+    const std::string stream = bench::load_fixture("openrouter_stream.sse");
+    constexpr size_t READ_SIZE = 1400; // roughly one TLS record per curl write
+    size_t sink = 0;
+    auto& r = bench::run("sse/stream_callback", stream.size(), [&] {
+        StreamRenderer renderer([&](TokenType, std::string_view s) { sink += s.size(); });
+        StreamContext ctx;
+        ctx.renderer = &renderer;
+        for (size_t off = 0; off < stream.size(); off += READ_SIZE) {
+            const size_t n = std::min(READ_SIZE, stream.size() - off);
+            StreamCallback(const_cast<char*>(stream.data() + off), 1, n, &ctx);
+        }
+        renderer.finish();
+    });
+    size_t events = 0;
+    for (size_t pos = 0; (pos = stream.find("data: ", pos)) != std::string::npos; pos += 6) ++events;
+    bench::metric(r, "events_per_second", events * r.iterations / r.seconds);
+    check(sink > 0, "sse/stream_callback produced no output");
+}
+
+// --- Turn Payload ---
+// The JSON work of one model request: a 20-message conversation copied into
+// the payload, serialized, and the reply stream parsed. Once on the global
+// heap, once in a TurnArena; reports heap allocations per request.
+static void bench_turn() {
+    const std::string stream = bench::load_fixture("openrouter_stream.sse");
+    const std::string text = bench::load_fixture("long_response.md");
+    json history = json::array();
+    for (size_t i = 0; i < 20; ++i) {
+        history.push_back({{"role", i % 2 ? "assistant" : "user"}, {"content", text.substr(i * 997 % (text.size() - 600), 600)}});
+    }
+    constexpr size_t READ_SIZE = 1400;
+
+    for (bool use_arena : {false, true}) {
+        size_t allocs = 0, calls = 0, sink = 0;
+        auto& r = bench::run(use_arena ? "turn/request arena" : "turn/request heap", 0, [&] {
+            const size_t before = bench::heap_allocations;
+            {
+                std::optional<TurnArena> arena;
+                if (use_arena) arena.emplace();
+                turn_json msgs = turn_json::array();
+                msgs.push_back({{"role", "system"}, {"content", text.substr(0, 2000)}});
+                for (const auto& m : history) msgs.push_back(turn_json(m));
+                turn_json pl = {{"model", "openai/gpt-4o-mini"}, {"messages", std::move(msgs)}, {"stream", true}, {"max_tokens", 4096}};
+                sink += pl.dump().size();
+
+                StreamRenderer renderer([&](TokenType, std::string_view s) { sink += s.size(); });
+                StreamContext ctx;
+                ctx.renderer = &renderer;
+                for (size_t off = 0; off < stream.size(); off += READ_SIZE) {
+                    StreamCallback(const_cast<char*>(stream.data() + off), 1, std::min(READ_SIZE, stream.size() - off), &ctx);
+                }
+                renderer.finish();
+            }
+            allocs += bench::heap_allocations - before;
+            calls++;
+        });
+        bench::metric(r, "heap_allocs_per_request", static_cast<double>(allocs) / calls);
+        check(sink > 0, "turn/request produced no output");
+    }
+}
+
+// --- Text Helpers ---
+// sanitize_utf8 runs on every user message and tool output, strip_reasoning
+// on every reply before it goes into history.
+static void bench_text() {
+    const std::string recorded = bench::load_fixture("long_response.md");
+    std::string clean;
+    for (int i = 0; i < 8; ++i) clean += recorded + "\n\n";
+
+    // Tool output with stray bytes (binary files cat'ed by a command)
+    std::string dirty = clean;
+    for (size_t i = 97; i < dirty.size(); i += 997) dirty[i] = static_cast<char>(0xFF);
+
+    size_t out = 0;
+    bench::run("text/sanitize_utf8 valid", clean.size(), [&] { out += sanitize_utf8(clean).size(); });
+    bench::run("text/sanitize_utf8 invalid bytes", dirty.size(), [&] { out += sanitize_utf8(dirty).size(); });
+
+    const std::string reasoning = "<think>" + recorded.substr(0, recorded.size() / 2) + "</think>\n" + clean;
+    bench::run("text/strip_reasoning with think", reasoning.size(), [&] { out += strip_reasoning(reasoning).size(); });
+    bench::run("text/strip_reasoning plain", clean.size(), [&] { out += strip_reasoning(clean).size(); });
+    check(out > 0, "text helpers produced no output");
+}
+
+// --- Nexus ---
+// retrieve_relevant and add_memory against fresh stores of several sizes,
+// filled with deterministic synthetic facts in a scratch directory.
+static std::string synthetic_fact(std::mt19937& rng, size_t id) {
+    static const std::vector<std::string> words = [] {
+        std::vector<std::string> w;
+        const char* syllables[] = {"ka", "lo", "mer", "tis", "van", "dor", "pel", "qua", "rin", "sto", "ul", "zen", "bri", "cho", "fen", "gat"};
+        for (auto a : syllables) for (auto b : syllables) w.push_back(std::string(a) + b);
+        return w;
+    }();
+    // mt19937's sequence is fixed by the standard, distributions are not.
+    // Mostly random words so the dedup threshold doesn't merge facts.
+    std::string w[8];
+    for (auto& x : w) x = words[rng() % words.size()];
+    switch (id % 4) {
+    case 0: return std::format("User prefers {} {} for {} {}, not {} {} {} {}.", w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7]);
+    case 1: return std::format("Project {} {} builds {} {} via {} {} {} {}.", w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7]);
+    case 2: return std::format("{} {} {} talks to {} {} {} over {} {}.", w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7]);
+    default: return std::format("Remember {} {} {} {} depends on {} {} {} {}.", w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7]);
+    }
+}
+
+static void bench_nexus() {
+    char tmpl[] = "/tmp/lira_bench_nexus_XXXXXX";
+    if (!mkdtemp(tmpl)) { check(false, "nexus: no scratch directory"); return; }
+    const std::string dir = tmpl;
+
+    // Dedup must keep facts that share a template but differ in their values,
+    // and still fold a reworded fact into the old one
+    {
+        Nexus nexus(dir + "/dedup.db");
+        const char* distinct[] = {
+            "The user's project Foo runs its dev server on port 8080",
+            "The user's project Bar runs its dev server on port 9090",
+            "User works on the lira project in /home/cv2/lira",
+            "User works on the nova project in /home/cv2/nova",
+            "User prefers vim as their editor",
+            "User prefers emacs as their editor",
+            "User's name is Alice",
+            "User's name is Bob",
+        };
+        for (const char* fact : distinct) nexus.add_memory(fact);
+        check(nexus.size() == std::size(distinct), std::format("nexus dedup kept {} of {} distinct facts", nexus.size(), std::size(distinct)));
+        nexus.add_memory("The user prefers vim as their editor.");
+        check(nexus.size() == std::size(distinct), "nexus dedup kept a reworded duplicate");
+        check(nexus.compact() == 0, "nexus compaction merged distinct facts");
+    }
+
+    for (size_t size : {100, 1000, 10000}) {
+        const std::string path = std::format("{}/nexus_{}.db", dir, size);
+        Nexus nexus(path);
+        std::mt19937 rng(42);
+        for (size_t i = 0; i < size; ++i) nexus.add_memory(synthetic_fact(rng, i));
+
+        std::vector<std::string> queries;
+        for (size_t i = 0; i < 16; ++i) queries.push_back("what does " + synthetic_fact(rng, i).substr(0, 40) + " use?");
+        size_t q = 0, out = 0;
+        auto& r = bench::run(std::format("nexus/retrieve n={}", size), 0, [&] {
+            out += nexus.retrieve_relevant(queries[q++ % queries.size()]).size();
+        });
+        bench::metric(r, "entries", static_cast<double>(nexus.size()));
+
+        // Store grows by the iteration count; short run keeps it near `size`
+        size_t id = size;
+        bench::run(std::format("nexus/add n={}", size), 0, [&] { nexus.add_memory(synthetic_fact(rng, id++)); }, 0.2);
+        check(out > 0, "nexus/retrieve returned nothing");
+    }
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+}
+
+// --- Metrics ---
+// Histogram recording runs once per streamed token
+static void bench_metrics() {
+    char tmpl[] = "/tmp/lira_bench_metrics_XXXXXX";
+    if (!mkdtemp(tmpl)) { check(false, "metrics: no scratch directory"); return; }
+    const std::string dir = tmpl;
+    {
+        Metrics metrics(dir + "/metrics.db");
+        const auto model = metrics.model("bench/model");
+        uint64_t v = 1;
+        bench::run("metrics/record", 0, [&] {
+            model.record(Metrics::TOKEN_GAP_US, v);
+            v = v * 6364136223846793005ull + 1442695040888963407ull;
+            v >>= 40;
+        });
+        bench::run("metrics/model lookup", 0, [&] { metrics.model("bench/model"); });
+        bench::run("metrics/snapshot", 0, [&] { metrics.stats(); }, 0.2);
+    }
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+}
+
+// --- Model Router ---
+// Feature extraction and the routing decision run before every request of a
+// turn; both should stay far below a millisecond next to the request itself.
+static void bench_router() {
+    const std::string text = bench::load_fixture("long_response.md");
+    const std::string output = "Output:\n" + text.substr(0, 1500);
+    ModelRouter router("bench/strong", {"bench/fast-a", "bench/fast-b"}, "");
+    StreamStats ok;
+    ok.completed = true;
+    ok.http_status = 200;
+    ok.deltas = 40;
+    ok.end = ok.start + std::chrono::milliseconds(900);
+    ok.first_delta = ok.start + std::chrono::milliseconds(300);
+    router.observe("bench/fast-a", ok);
+
+    size_t fast = 0;
+    bench::run("router/route tool follow-up", output.size(), [&] {
+        fast += router.route(ModelRouter::features(output, 30000, true)).tier == std::string_view("fast");
+    });
+    bench::run("router/route user message", 0, [&] {
+        fast += router.route(ModelRouter::features("What time is it in Berlin?", 12000, false)).tier == std::string_view("fast");
+    });
+    bench::run("router/observe", 0, [&] { router.observe("bench/fast-b", ok); });
+    check(fast > 0, "router: nothing routed to the fast tier");
+
+    // A fast model that keeps failing is written off, then probed again
+    // once its error rate has decayed
+    ModelRouter flaky("bench/strong", {"bench/fast-a", "bench/fast-b"}, "");
+    flaky.error_half_life = std::chrono::milliseconds(20);
+    flaky.observe("bench/fast-b", ok);
+    StreamStats failed;
+    failed.http_status = 503;
+    for (int i = 0; i < 3; ++i) flaky.observe("bench/fast-a", failed);
+    const auto chat = ModelRouter::features("What time is it in Berlin?", 12000, false);
+    check(flaky.route(chat).model == "bench/fast-b", "router: failing fast model was not skipped");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(flaky.route(chat).model == "bench/fast-a", "router: failing fast model was never retried");
+}
+
+// --- Work Pool ---
+// Round trip of a trivial task through the <spawn> pool, one at a time and in
+// bursts where idle workers have to steal.
+static void bench_pool() {
+    WorkStealingPool pool(4);
+    size_t sink = 0;
+    bench::run("pool/submit+wait", 0, [&] { sink += pool.submit([] { return 1; }).get(); });
+    std::vector<std::future<int>> burst;
+    auto& r = bench::run("pool/burst 64", 0, [&] {
+        burst.clear();
+        for (int i = 0; i < 64; ++i) burst.push_back(pool.submit([i] { return i; }));
+        for (auto& f : burst) sink += f.get();
+    });
+    const auto st = pool.stats();
+    bench::metric(r, "stolen_fraction", st.executed ? static_cast<double>(st.stolen) / st.executed : 0.0);
+    check(sink > 0, "pool: no task ran");
+}
+
+// --- WebSearcher ---
+// Result extraction from saved Google basic-HTML pages. The regex variant
+// is the pre-tokenizer extractor, kept here as a baseline.
+static size_t legacy_regex_extract(const std::string& buffer) {
+    std::regex snippet_regex(R"(<div class="BNeawe[^>]*>(.*?)</div>)");
+    std::vector<std::string> hits;
+    for (auto i = std::sregex_iterator(buffer.begin(), buffer.end(), snippet_regex); i != std::sregex_iterator(); ++i) {
+        std::string text = std::regex_replace(i->str(1), std::regex(R"(<[^>]*>)"), "");
+        text = std::regex_replace(text, std::regex(R"(&nbsp;)"), " ");
+        text = std::regex_replace(text, std::regex(R"(&amp;)"), "&");
+        text = std::regex_replace(text, std::regex(R"(&quot;)"), "\"");
+        text = std::regex_replace(text, std::regex(R"(&#39;)"), "'");
+        text = std::regex_replace(text, std::regex(R"(&lt;)"), "<");
+        text = std::regex_replace(text, std::regex(R"(&gt;)"), ">");
+        if (text.length() < 15 || text.find("Google Home") != std::string::npos || text.find("Settings") != std::string::npos) continue;
+        bool duplicate = false;
+        for (const auto& h : hits) if (text.find(h) != std::string::npos) { duplicate = true; break; }
+        if (duplicate) continue;
+        hits.push_back(text);
+        if (hits.size() >= 5) break;
+    }
+    return hits.size();
+}
+
+static void bench_websearch() {
+    for (const char* name : {"google_rust_async.html", "google_cmake_fetchcontent.html"}) {
+        const std::string page = bench::load_fixture(name);
+        const std::string file = name;
+        const std::string label = file.substr(7, file.find('.') - 7); // drop "google_"
+        check(WebSearcher::parse_results(page).size() == 5, label + ": expected 5 results");
+
+        size_t found = 0;
+        bench::run("websearch/tokenizer " + label, page.size(), [&] {
+            found += WebSearcher::parse_results(page).size();
+        });
+        bench::run("websearch/tokenizer-all " + label, page.size(), [&] {
+            found += WebSearcher::parse_results(page, SIZE_MAX).size();
+        });
+        bench::run("websearch/regex " + label, page.size(), [&] {
+            found += legacy_regex_extract(page);
+        });
+        check(found > 0, "websearch produced no results");
+    }
+}
+
+// --- Page Extraction ---
+// Main-text extraction as done in the curl write callback: 4 KB chunks until
+// the text budget stops the tokenizer. Also reports how much of the page had
+// to be downloaded.
+static void bench_page_extract() {
+    const std::string page = bench::load_fixture("article.html");
+    for (size_t budget : {size_t(2000), size_t(8000), SIZE_MAX}) {
+        size_t consumed = 0, text = 0;
+        bench::run(std::format("fetch/extract article budget={}", budget == SIZE_MAX ? std::string("all") : std::to_string(budget)), page.size(), [&] {
+            html::TextCollector collector(budget);
+            html::Tokenizer tokenizer(collector);
+            collector.attach(tokenizer);
+            consumed = 0;
+            for (; consumed < page.size() && !tokenizer.is_stopped(); consumed += 4096) {
+                tokenizer.feed(std::string_view(page).substr(consumed, 4096));
+            }
+            tokenizer.finish();
+            text = collector.take().size();
+        });
+        std::cerr << std::format("{:<40} {:>10} of {} bytes read, {} bytes of text\n", "", std::min(consumed, page.size()), page.size(), text);
+    }
+}
+
+// --- Search Pipeline ---
+// Multi-query search plus top-N page fetch against a local stand-in with
+// fixed latencies (search 50 ms, page 100 ms). Reports wall time per batch.
+static void bench_search_pipeline() {
+    bench::LocalHttpServer server;
+    std::string page = bench::load_fixture("google_rust_async.html");
+    // Point the result links at the stand-in: /url?q=http://127.0.0.1:PORT/page/tokio.rs/
+    const std::string from = "/url?q=https://", to = "/url?q=" + server.url("/page/");
+    for (size_t pos = 0; (pos = page.find(from, pos)) != std::string::npos; pos += to.size()) page.replace(pos, from.size(), to);
+    server.route("/search", {page, "text/html", 50});
+    server.route("/page/", {bench::load_fixture("article.html"), "text/html", 100});
+
+    const std::vector<std::string> queries = {"rust async runtime", "tokio vs smol", "io_uring rust"};
+    SearchOptions opt;
+    opt.endpoint = server.url("/search");
+    opt.use_cache = false;
+    opt.fetch_pages = 5;
+
+    auto timed = [&](const std::string& name, auto&& fn) {
+        using clock = std::chrono::steady_clock;
+        server.reset_peak();
+        const auto start = clock::now();
+        const std::string summary = fn();
+        const double secs = std::chrono::duration<double>(clock::now() - start).count();
+        std::cerr << std::format("{:<40} {:>10.0f} ms   peak {} conns   {}\n", name, secs * 1e3, server.peak_connections(), summary);
+        auto& r = bench::results().emplace_back(bench::Result{name, 1, 0, secs, {}});
+        r.metrics.emplace_back("peak_connections", server.peak_connections());
+    };
+    auto summarize = [](const std::vector<QueryResults>& batch) {
+        size_t results = 0, pages = 0, partial = 0;
+        for (const auto& q : batch) {
+            results += q.results.size();
+            for (const auto& r : q.results) { pages += !r.page.text.empty(); partial += r.page.partial; }
+        }
+        return std::format("{} results, {} pages ({} partial)", results, pages, partial);
+    };
+
+    opt.max_host_connections = 1;
+    timed("search/sequential 3q x 5 pages", [&] {
+        std::vector<QueryResults> all;
+        for (const auto& q : queries) all.push_back(WebSearcher::search({q}, opt)[0]);
+        return summarize(all);
+    });
+    opt.max_host_connections = 2;
+    timed("search/batch 3q x 5 pages, 2/host", [&] { return summarize(WebSearcher::search(queries, opt)); });
+    opt.max_host_connections = 8;
+    timed("search/batch 3q x 5 pages, 8/host", [&] { return summarize(WebSearcher::search(queries, opt)); });
+
+    // One result page hangs: the batch returns at the deadline with the rest
+    server.route("/page/github.com/", {bench::load_fixture("article.html"), "text/html", 1500});
+    opt.deadline = std::chrono::milliseconds(400);
+    timed("search/deadline 400ms, 1 slow page", [&] { return summarize(WebSearcher::search(queries, opt)); });
+}
+
+static void usage() {
+    std::cerr << "Usage: lira_bench [--filter NAME] [--quick] [--json FILE|-]\n"
+                 "  --filter NAME  run only groups whose name contains NAME\n"
+                 "                 (renderer, sse, text, nexus, websearch, fetch, search)\n"
+                 "  --quick        shorter runs, for smoke testing\n"
+                 "  --json FILE    write results as JSON (- for stdout)\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string json_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) bench::config().filter = argv[++i];
+        else if (arg == "--json" && i + 1 < argc) json_path = argv[++i];
+        else if (arg == "--quick") bench::config().time_scale = 0.1;
+        else { usage(); return arg == "-h" || arg == "--help" ? 0 : 2; }
+    }
+
+    const std::pair<const char*, void(*)()> groups[] = {
+        {"renderer", bench_renderer},
+        {"sse", bench_sse},
+        {"turn", bench_turn},
+        {"text", bench_text},
+        {"nexus", bench_nexus},
+        {"metrics", bench_metrics},
+        {"router", bench_router},
+        {"pool", bench_pool},
+        {"websearch", bench_websearch},
+        {"fetch", bench_page_extract},
+        {"search", bench_search_pipeline},
+    };
+    for (const auto& [name, fn] : groups) {
+        if (bench::selected(name)) fn();
+    }
+
+    if (!json_path.empty() && !bench::write_json(json_path)) {
+        std::cerr << "Failed to write " << json_path << std::endl;
+        return 1;
+    }
+    return failed_checks ? 1 : 0;
+}
@@ -0,0 +1,223 @@
+#include "AllocCount.h"
+#include "Bench.h"
+#include "MockOpenRouter.h"
+#include "Agent.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <sys/wait.h>
+
+using namespace lira;
+namespace fs = std::filesystem;
+
+// End-to-end latency through the real Agent, StreamRenderer and libcurl
+// against the mock OpenRouter endpoint: time to first token, token rate,
+// tool round trip and whole-turn latency, as p50/p90 over several turns.
+//
+//   lira_e2e [--turns N] [--rate TOK_PER_S] [--ttft MS] [--filter NAME] [--json FILE|-]
+
+namespace
+{
+    struct Options {
+        int turns = 10;
+        double rate = 200;
+        int ttft = 100;
+    };
+
+    double percentile(std::vector<double> v, double p) {
+        if (v.empty()) return 0;
+        std::ranges::sort(v);
+        return v[std::min(v.size() - 1, static_cast<size_t>(p * (v.size() - 1) + 0.5))];
+    }
+
+    void report(bench::Result& r, const std::string& key, const std::vector<double>& samples) {
+        bench::metric(r, key + "_p50", percentile(samples, 0.5));
+        bench::metric(r, key + "_p90", percentile(samples, 0.9));
+    }
+
+    // Agent wired for unattended runs: output is counted, not rendered, and
+    // every command is approved
+    struct Harness {
+        std::unique_ptr<Agent> agent;
+        size_t rendered = 0;
+
+        explicit Harness(const std::string& session) {
+            // The constructor announces the session on stdout, which may carry --json -
+            std::streambuf* out = std::cout.rdbuf(nullptr);
+            agent = std::make_unique<Agent>(session);
+            std::cout.rdbuf(out);
+            agent->on_token = [this](TokenType, std::string_view text) { rendered += text.size(); };
+            agent->approve_command = [](const std::string&) { return true; };
+        }
+    };
+
+    using clock = std::chrono::steady_clock;
+
+    // Runs `turns` turns against `config` and records the latency figures under `name`
+    bench::Result& scenario(const std::string& name, bench::MockConfig config, const Options& opt, const std::string& prompt) {
+        bench::MockOpenRouter server(std::move(config));
+        if (!server.listening()) { std::cerr << "Cannot start mock server" << std::endl; std::exit(1); }
+        setenv("LIRA_API_URL", server.endpoint().c_str(), 1);
+
+        Harness h(name.substr(name.find('/') + 1));
+        std::vector<double> turn_ms, ttft_ms, tok_s, tool_ms;
+        size_t failed = 0, heap_allocs = 0, arena_allocs = 0;
+
+        const auto start = clock::now();
+        for (int i = 0; i < opt.turns; ++i) {
+            const auto t0 = clock::now();
+            const size_t allocs_before = bench::heap_allocations;
+            h.agent->process(prompt);
+            turn_ms.push_back(std::chrono::duration<double, std::milli>(clock::now() - t0).count());
+            heap_allocs += bench::heap_allocations - allocs_before;
+            arena_allocs += h.agent->last_arena.allocations;
+
+            const auto& reqs = h.agent->last_requests;
+            for (size_t k = 0; k < reqs.size(); ++k) {
+                const auto& s = reqs[k];
+                if (!s.completed || s.http_status != 200 || !s.deltas) { failed++; continue; }
+                ttft_ms.push_back(s.ttft_ms());
+                if (s.deltas > 1) tok_s.push_back(s.tokens_per_second());
+                // Tool round trip: end of the reply with the tag to the first token of the answer
+                if (k > 0 && reqs[k - 1].deltas) {
+                    tool_ms.push_back(std::chrono::duration<double, std::milli>(s.first_delta - reqs[k - 1].end).count());
+                }
+            }
+        }
+
+        bench::Result r;
+        r.name = name;
+        r.iterations = static_cast<size_t>(opt.turns);
+        r.seconds = std::chrono::duration<double>(clock::now() - start).count();
+        std::cerr << std::format("{:<40} {:>10.1f} ms/turn {:>9} req\n", name, r.seconds * 1e3 / opt.turns, server.requests());
+        bench::results().push_back(std::move(r));
+        auto& res = bench::results().back();
+
+        report(res, "turn_ms", turn_ms);
+        report(res, "ttft_ms", ttft_ms);
+        report(res, "tok_per_s", tok_s);
+        if (!tool_ms.empty()) report(res, "tool_roundtrip_ms", tool_ms);
+        bench::metric(res, "failed_requests", static_cast<double>(failed));
+        bench::metric(res, "rendered_bytes", static_cast<double>(h.rendered));
+        const auto summaries = std::ranges::count_if(h.agent->history, [](const auto& m) { return m.value("summary", false); });
+        if (summaries) bench::metric(res, "history_summaries", static_cast<double>(summaries));
+        // Compare against a LIRA_TURN_ARENA=0 run for the arena's effect
+        bench::metric(res, "heap_allocs_per_turn", static_cast<double>(heap_allocs) / opt.turns);
+        bench::metric(res, "arena_allocs_per_turn", static_cast<double>(arena_allocs) / opt.turns);
+        return res;
+    }
+
+    bench::MockConfig base(const Options& opt) {
+        bench::MockConfig c;
+        c.tokens_per_second = opt.rate;
+        c.first_token_ms = opt.ttft;
+        return c;
+    }
+
+    int run_scenarios(const Options& opt) {
+        if (bench::selected("e2e/chat")) {
+            auto c = base(opt);
+            c.reply = "Sure. **Build** it with `cmake --build build -j` and then run the tests:\n\n"
+                      "```bash\nctest --test-dir build --output-on-failure\n```\n\nThat covers the whole tree.";
+            scenario("e2e/chat", c, opt, "How do I build and test this project?");
+        }
+        if (bench::selected("e2e/tool")) {
+            auto c = base(opt);
+            c.script = {
+                {"Output:", "The command printed `lira-e2e`, so the shell works."},
+                {"", "<cmd>echo lira-e2e</cmd>"},
+            };
+            scenario("e2e/tool", c, opt, "Check that the shell works.");
+        }
+        if (bench::selected("e2e/replay")) {
+            auto c = base(opt);
+            // The recording ends in <cmd>nproc</cmd>; answer the tool output so the turn ends
+            c.replay = bench::load_fixture("openrouter_stream.sse");
+            c.script = {{"Output:", "Thanks, that is the core count. I will update the script."}};
+            scenario("e2e/replay", c, opt, "Explain the build.");
+        }
+        if (bench::selected("e2e/compact")) {
+            // Long replies push the history past a low threshold every few turns;
+            // summaries run on the side and must not show up in turn latency
+            auto c = base(opt);
+            c.script = {{"[user]\n", "The user asked for build help several times; all answers pointed to cmake and ctest."}};
+            c.reply = std::string(1500, 'x');
+            for (size_t i = 64; i < c.reply.size(); i += 64) c.reply[i] = ' ';
+            setenv("LIRA_COMPACT_CHARS", "4000", 1);
+            scenario("e2e/compact", c, opt, "How do I build and test this project?");
+            unsetenv("LIRA_COMPACT_CHARS");
+        }
+        if (bench::selected("e2e/spawn")) {
+            // Four children on the pool; with LIRA_SPAWN_WORKERS >= 4 the turn
+            // should cost about two requests more than a plain reply, not five
+            auto c = base(opt);
+            c.script = {
+                {"Sub-agent Results:", "All four services are up."},
+                {"check service", "The service answered its health check."},
+                {"", "<spawn>check service alpha</spawn><spawn>check service beta</spawn>"
+                     "<spawn>check service gamma</spawn><spawn>check service delta</spawn>"},
+            };
+            scenario("e2e/spawn", c, opt, "Are all services healthy?");
+        }
+        if (bench::selected("e2e/errors")) {
+            auto c = base(opt);
+            c.error_every = 2;
+            c.error = bench::MockConfig::Error::Http500;
+            scenario("e2e/errors", c, opt, "Hello?");
+        }
+        return 0;
+    }
+
+    // BASE_DIR is fixed from $HOME at static init, so the scenarios run in a
+    // child process whose HOME is a scratch directory; sessions, Nexus and
+    // caches never touch the real ~/.lira
+    int run_isolated(char* argv[]) {
+        std::string tmpl = (fs::temp_directory_path() / "lira-e2e-XXXXXX").string();
+        if (!mkdtemp(tmpl.data())) { std::cerr << "Cannot create scratch HOME" << std::endl; return 1; }
+
+        const pid_t pid = fork();
+        if (pid == 0) {
+            setenv("HOME", tmpl.c_str(), 1);
+            setenv("LIRA_E2E_CHILD", "1", 1);
+            setenv("OPENROUTER_API_KEY", "mock", 1);
+            execv("/proc/self/exe", argv);
+            _exit(127);
+        }
+        int status = 1;
+        if (pid > 0) waitpid(pid, &status, 0);
+        std::error_code ec;
+        fs::remove_all(tmpl, ec);
+        return pid > 0 && WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    std::string json_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        try {
+            if (arg == "--turns" && has_value) opt.turns = std::max(1, std::stoi(argv[++i]));
+            else if (arg == "--rate" && has_value) opt.rate = std::stod(argv[++i]);
+            else if (arg == "--ttft" && has_value) opt.ttft = std::stoi(argv[++i]);
+            else if (arg == "--filter" && has_value) bench::config().filter = argv[++i];
+            else if (arg == "--json" && has_value) json_path = argv[++i];
+            else throw std::invalid_argument(arg);
+        } catch (...) {
+            std::cerr << "Usage: lira_e2e [--turns N] [--rate TOK_PER_S] [--ttft MS] [--filter NAME] [--json FILE|-]" << std::endl;
+            return 2;
+        }
+    }
+
+    if (!std::getenv("LIRA_E2E_CHILD")) return run_isolated(argv);
+
+    std::signal(SIGPIPE, SIG_IGN);
+    const int rc = run_scenarios(opt);
+    if (!json_path.empty() && !bench::write_json(json_path)) {
+        std::cerr << "Cannot write " << json_path << std::endl;
+        return 1;
+    }
+    return rc;
+}
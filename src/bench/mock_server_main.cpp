@@ -0,0 +1,90 @@
+#include "MockOpenRouter.h"
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace lira;
+
+// Runs the mock OpenRouter endpoint until interrupted, for driving the real
+// `lira` binary offline:
+//   lira_mock_server --port 8089 --rate 50 &
+//   LIRA_API_URL=http://127.0.0.1:8089/api/v1/chat/completions OPENROUTER_API_KEY=mock lira "hi"
+
+static void usage() {
+    std::cerr << "Usage: lira_mock_server [options]\n"
+                 "  --port N             listen port (default 8089)\n"
+                 "  --rate TOK_PER_S     token rate, 0 = unpaced (default 200)\n"
+                 "  --ttft MS            delay before the first token (default 200)\n"
+                 "  --chars-per-token N  reply bytes per SSE delta (default 4)\n"
+                 "  --reply TEXT         default reply\n"
+                 "  --script FILE        JSON [{\"when\": \"...\", \"reply\": \"...\"}], first match on the last message wins\n"
+                 "  --replay FILE        replay a recorded SSE stream when no script step matches\n"
+                 "  --error-every N      fail every Nth request\n"
+                 "  --error-kind K       500 | 429 | disconnect | event (default 500)\n";
+}
+
+static bool read_file(const std::string& path, std::string& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    std::stringstream ss;
+    ss << f.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    bench::MockConfig config;
+    int port = 8089;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "--port" && has_value) port = std::stoi(argv[++i]);
+            else if (arg == "--rate" && has_value) config.tokens_per_second = std::stod(argv[++i]);
+            else if (arg == "--ttft" && has_value) config.first_token_ms = std::stoi(argv[++i]);
+            else if (arg == "--chars-per-token" && has_value) config.chars_per_token = std::stoul(argv[++i]);
+            else if (arg == "--reply" && has_value) config.reply = argv[++i];
+            else if (arg == "--error-every" && has_value) config.error_every = std::stoul(argv[++i]);
+            else if (arg == "--error-kind" && has_value) {
+                const std::string kind = argv[++i];
+                if (kind == "500") config.error = bench::MockConfig::Error::Http500;
+                else if (kind == "429") config.error = bench::MockConfig::Error::Http429;
+                else if (kind == "disconnect") config.error = bench::MockConfig::Error::Disconnect;
+                else if (kind == "event") config.error = bench::MockConfig::Error::ErrorEvent;
+                else { usage(); return 2; }
+            }
+            else if (arg == "--replay" && has_value) {
+                if (!read_file(argv[++i], config.replay)) { std::cerr << "Cannot read " << argv[i] << std::endl; return 1; }
+            }
+            else if (arg == "--script" && has_value) {
+                std::string text;
+                if (!read_file(argv[++i], text)) { std::cerr << "Cannot read " << argv[i] << std::endl; return 1; }
+                for (const auto& step : nlohmann::json::parse(text)) {
+                    config.script.push_back({step.value("when", ""), step.value("reply", "")});
+                }
+            }
+            else { usage(); return arg == "-h" || arg == "--help" ? 0 : 2; }
+        }
+    } catch (...) {
+        usage();
+        return 2;
+    }
+
+    // Serve until SIGINT/SIGTERM; blocked before the server threads start so only sigwait sees them
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    bench::MockOpenRouter server(config, port);
+    if (!server.listening()) { std::cerr << "Cannot listen on port " << port << std::endl; return 1; }
+    std::cerr << "Mock OpenRouter at " << server.endpoint() << std::endl;
+
+    int sig = 0;
+    sigwait(&set, &sig);
+    std::cerr << "Served " << server.requests() << " requests" << std::endl;
+    return 0;
+}
@@ -7,8 +7,17 @@
 #include <string>
 #include <filesystem>
 #include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <future>
+#include <list>
+#include <optional>
+#include <thread>
 #include "Agent.h" // Includes ChatMessage struct
+#include "Document.h"
 #include "Helpers.h"
+#include "SearchCache.h"
+#include "SpscRing.h"
 
 // --- Styling Constants ---
 ImVec4 col_bg;
@@ -23,6 +32,121 @@ ImU32 col_user_bg;
 ImU32 col_user_text;
 ImU32 col_shadow = IM_COL32(0, 0, 0, 80);
 
+// --- Message Views ---
+// Positioned piece of a block's text, relative to the block origin
+struct LayoutRun {
+    ImVec2 pos;
+    uint32_t begin, end;
+    lira::TokenType style;
+};
+
+// Wrapped layout of one block, valid while width and block version match
+struct BlockLayout {
+    float width = -1.0f;
+    uint64_t version = ~0ull;
+    ImVec2 size;
+    std::vector<LayoutRun> runs;
+};
+
+// Markdown document for one history message, parsed on first display
+struct MessageView {
+    const lira::ChatMessage* msg;   // stable: the agent's display log is append-only
+    lira::Document doc;
+    bool parsed = false;
+    bool thinking = false;          // streaming view inside <think>
+    std::vector<BlockLayout> layouts;
+
+    // Measured text size, valid while doc version and wrap width match
+    ImVec2 text_size;
+    float measured_width = -1.0f;
+    uint64_t measured_version = ~0ull;
+    // Height guess used for scrolling before the message is first laid out
+    float estimate = 0.0f;
+    float estimate_width = -1.0f;
+
+    explicit MessageView(const lira::ChatMessage& m) : msg(&m) {}
+
+    void ensure_parsed() {
+        if (parsed) return;
+        lira::StreamRenderer parser([this](lira::TokenType t, std::string_view s) { doc.append(t, s); });
+        parser.apply_writes = false; // history text must not touch disk
+        parser.print(msg->content);
+        parser.finish();
+        doc.finish();
+        parsed = true;
+    }
+};
+
+// Top of each message in transcript space; offsets[n] is the total height
+struct TranscriptLayout {
+    std::vector<float> offsets;
+    float width = -1.0f;
+    bool dirty = true;       // messages added or removed, or an earlier height changed
+    bool tail_dirty = false; // only the last message grew: just offsets.back() moves
+};
+
+// Rolling CPU time spent building and submitting a frame (excludes vsync wait)
+struct FrameStats {
+    static constexpr int WINDOW = 120;
+    float samples[WINDOW] = {};
+    int next = 0, count = 0;
+
+    void add(float ms) { samples[next] = ms; next = (next + 1) % WINDOW; count = std::min(count + 1, WINDOW); }
+    float avg() const { float s = 0; for (int i = 0; i < count; ++i) s += samples[i]; return count ? s / count : 0.0f; }
+    float max() const { float m = 0; for (int i = 0; i < count; ++i) m = std::max(m, samples[i]); return m; }
+};
+
+// --- Event-Driven Rendering ---
+// When idle the loop sleeps in glfwWaitEventsTimeout and only draws after
+// input, worker wake-ups (glfwPostEmptyEvent), resize or a timeout.
+const double IDLE_TIMEOUT = 2.0;          // s; periodic redraw when nothing happens
+const double CURSOR_BLINK_TIMEOUT = 0.5;  // s; keeps the input caret blinking
+const int SETTLE_FRAMES = 3;              // frames drawn after each wake so hover/press states settle
+const float IDLE_CPU_TARGET = 1.0f;       // % of one core while idle
+
+// Process CPU usage over roughly one-second windows, idle time included
+struct CpuMeter {
+    std::clock_t cpu_prev = std::clock();
+    double wall_prev = 0.0;
+    float percent = 0.0f;
+
+    void sample(double now) {
+        if (now - wall_prev < 1.0) return;
+        const std::clock_t cpu = std::clock();
+        if (wall_prev > 0.0) percent = static_cast<float>(100.0 * (cpu - cpu_prev) / CLOCKS_PER_SEC / (now - wall_prev));
+        cpu_prev = cpu;
+        wall_prev = now;
+    }
+};
+
+// Rendered segment handed from the agent worker to the render thread
+struct TokenSegment {
+    lira::TokenType type;
+    std::string text;
+};
+
+// --- Session Cache ---
+// An open session: its agent, loaded in the background, plus the views built
+// from it. Keeping both cached makes switching back to a session instant.
+struct Session {
+    std::string name;
+    std::future<std::unique_ptr<lira::Agent>> loading;
+    std::unique_ptr<lira::Agent> agent;   // null while loading (placeholder shown)
+    bool failed = false;
+    std::vector<std::unique_ptr<MessageView>> views;
+    uint64_t views_version = ~0ull;       // agent display_version() the views were built from
+    TranscriptLayout transcript;
+
+    bool is_loading() const { return !agent && !failed; }
+};
+
+size_t SessionCacheSize() {
+    if (const char* env = std::getenv("LIRA_GUI_SESSION_CACHE")) {
+        try { return std::max(std::stoul(env), 1ul); } catch (...) {}
+    }
+    return 5;
+}
+
 // --- Global State ---
 struct AppState {
     // Settings
@@ -35,17 +159,132 @@ struct AppState {
     bool new_session_open = false;
     char new_session_buf[64] = "";
     std::vector<std::string> session_list;
-    std::unique_ptr<lira::Agent> active_agent;
+    std::list<std::unique_ptr<Session>> sessions;  // most recently used first
+    Session* active = nullptr;
+    size_t session_cache_size = SessionCacheSize();
+    std::shared_ptr<lira::Nexus> nexus;           // pinned so evicting agents never reloads it
+    bool show_frame_stats = std::getenv("LIRA_GUI_STATS") != nullptr;
+    FrameStats frame_stats;
+    bool event_driven = std::getenv("LIRA_GUI_CONTINUOUS") == nullptr;
+    int redraw_frames = SETTLE_FRAMES;
+    uint64_t frames_rendered = 0;
+    CpuMeter cpu;
+    std::atomic<bool> wake_posted{false};   // one glfwPostEmptyEvent per render pass
+
+    // Agent Worker: process() runs off the render thread and streams its
+    // tokens through a lock-free ring; the views for the in-flight exchange
+    // live outside the display log until the worker is done.
+    std::thread worker;
+    std::atomic<bool> busy{false};
+    lira::SpscRing<TokenSegment, 4096> tokens;
+    lira::ChatMessage pending_user, live_msg;
+    std::vector<std::unique_ptr<MessageView>> live_views;
+
+    // Command approval requested by the worker, answered by a modal
+    std::mutex approval_mtx;
+    std::string approval_cmd;
+    std::optional<std::promise<bool>> approval_reply;
 
     AppState() {
         const char* env_key = std::getenv("OPENROUTER_API_KEY");
         if (env_key) strncpy(apiKey, env_key, sizeof(apiKey) - 1);
+    }
 
-        // Load initial session
+    // Runs from main(): agents load on background threads, which must not
+    // start during static initialization
+    void start() {
+        nexus = lira::Nexus::shared();
         refresh_sessions();
         std::string start_session = "main";
         if (!session_list.empty()) start_session = session_list[0];
-        active_agent = std::make_unique<lira::Agent>(start_session);
+        switch_session(start_session);
+    }
+
+    // Called from worker threads; coalesces wake-ups until the next frame
+    void wake() {
+        if (!wake_posted.exchange(true)) glfwPostEmptyEvent();
+    }
+
+    // Both hooks run on the worker thread
+    void attach(lira::Agent& agent) {
+        agent.on_token = [this](lira::TokenType type, std::string_view text) {
+            TokenSegment seg{type, std::string(text)};
+            // Ring full: the render thread is behind, wait for it
+            while (!tokens.try_push(std::move(seg))) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            wake();
+        };
+        agent.approve_command = [this](const std::string& cmd) {
+            std::future<bool> answer;
+            {
+                std::lock_guard lock(approval_mtx);
+                approval_cmd = cmd;
+                answer = approval_reply.emplace().get_future();
+            }
+            wake();
+            return answer.get();
+        };
+    }
+
+    void answer_approval(bool allowed) {
+        std::lock_guard lock(approval_mtx);
+        if (!approval_reply) return;
+        approval_reply->set_value(allowed);
+        approval_reply.reset();
+    }
+
+    void send(const std::string& prompt) {
+        if (busy.load() || !active->agent) return;
+        if (worker.joinable()) worker.join();
+        pending_user = {"user", prompt};
+        live_msg = {"assistant", ""};
+        live_views.clear();
+        live_views.push_back(std::make_unique<MessageView>(pending_user));
+        auto& live = *live_views.emplace_back(std::make_unique<MessageView>(live_msg));
+        live.parsed = true; // fed from the token ring
+        active->transcript.dirty = true;
+
+        busy.store(true);
+        worker = std::thread([this, agent = active->agent.get(), prompt] {
+            lira::trace::set_thread_name("agent worker");
+            agent->process(prompt);
+            busy.store(false, std::memory_order_release);
+            wake();
+        });
+    }
+
+    // Drains streamed tokens into the live view; once the worker is done the
+    // exchange is in the display log and the live views are dropped.
+    void pump_tokens() {
+        if (live_views.empty()) return;
+        const bool done = !busy.load(std::memory_order_acquire);
+        auto& live = *live_views.back();
+        TokenSegment seg;
+        while (tokens.try_pop(seg)) {
+            live.thinking = seg.type == lira::TokenType::Thinking;
+            live.doc.append(seg.type, seg.text);
+            active->transcript.tail_dirty = true;
+            redraw_frames = std::max(redraw_frames, 1);
+        }
+        if (done) {
+            worker.join();
+            live_views.clear();
+            active->transcript.dirty = true;
+            redraw_frames = SETTLE_FRAMES;
+        }
+    }
+
+    // Unblocks a worker waiting on approval or ring space, then joins it
+    void shutdown() {
+        TokenSegment seg;
+        while (busy.load()) {
+            answer_approval(false);
+            while (tokens.try_pop(seg)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (worker.joinable()) worker.join();
+        // Waits for background loads; std::future from std::async joins on destruction
+        sessions.clear();
+        lira::SearchCache::shared()->wait_revalidations();
     }
 
     void refresh_sessions() {
@@ -61,8 +300,79 @@ struct AppState {
         std::sort(session_list.begin(), session_list.end());
     }
 
+    // Cached session for `name`, moved to the front of the LRU; starts a
+    // background load on a miss
+    Session& touch(const std::string& name) {
+        auto it = std::find_if(sessions.begin(), sessions.end(), [&](const auto& s) { return s->name == name; });
+        if (it != sessions.end()) {
+            sessions.splice(sessions.begin(), sessions, it);
+            return *sessions.front();
+        }
+        auto s = std::make_unique<Session>();
+        s->name = name;
+        s->loading = std::async(std::launch::async, [name] { return std::make_unique<lira::Agent>(name); });
+        sessions.push_front(std::move(s));
+        evict();
+        return *sessions.front();
+    }
+
+    // Drops least recently used sessions over the limit; never the active one
+    // or one still loading (its future would block the render thread)
+    void evict() {
+        for (auto it = sessions.end(); sessions.size() > session_cache_size && it != sessions.begin();) {
+            --it;
+            if (it->get() == active || (*it)->is_loading()) continue;
+            it = sessions.erase(it);
+        }
+    }
+
+    // Instant for cached sessions; neighbours in the sidebar are preloaded
     void switch_session(const std::string& name) {
-        active_agent = std::make_unique<lira::Agent>(name);
+        if (busy.load()) return; // the worker holds the current agent
+        const auto pos = std::find(session_list.begin(), session_list.end(), name);
+        if (pos != session_list.end()) {
+            if (pos + 1 != session_list.end()) touch(*(pos + 1));
+            if (pos != session_list.begin()) touch(*(pos - 1));
+        }
+        active = &touch(name);
+        active->transcript.dirty = true;
+    }
+
+    // Adopts agents whose background load finished; keeps drawing until then
+    void poll_sessions() {
+        for (auto& s : sessions) {
+            if (!s->is_loading()) continue;
+            if (s->loading.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                redraw_frames = std::max(redraw_frames, 1);
+                continue;
+            }
+            try {
+                s->agent = s->loading.get();
+                attach(*s->agent);
+            } catch (...) {
+                s->failed = true;
+            }
+            s->transcript.dirty = true;
+        }
+    }
+
+    // The agent's display log is append-only, so only messages past the
+    // views we already have are added; parsing waits until one is on screen.
+    void sync_views() {
+        auto& s = *active;
+        // While the worker runs, the in-flight exchange is shown by live_views
+        if (!s.agent || !live_views.empty() || s.agent->display_version() == s.views_version) return;
+        s.views_version = s.agent->display_version();
+        std::vector<const lira::ChatMessage*> added;
+        s.agent->display_since(s.views.size(), added);
+        for (const auto* msg : added) s.views.push_back(std::make_unique<MessageView>(*msg));
+        s.transcript.dirty = true;
+    }
+
+    size_t view_count() const { return active->views.size() + live_views.size(); }
+    MessageView& view_at(size_t i) {
+        auto& views = active->views;
+        return i < views.size() ? *views[i] : *live_views[i - views.size()];
     }
 };
 
@@ -99,49 +409,197 @@ void SetTheme(int index) {
     style.Colors[ImGuiCol_FrameBg] = col_input_bg; style.Colors[ImGuiCol_Header] = col_accent;
 }
 
+// --- Document Layout ---
+const float CODE_PAD = 10.0f;     // inset of code inside its box
+const float BLOCK_GAP = 8.0f;     // space between blocks
+
+// Word-wrapped runs for one block. Only called for blocks whose version or
+// wrap width changed, i.e. the streaming tail or everything after a resize.
+void LayoutBlock(const lira::DocBlock& block, BlockLayout& layout, float wrap_w) {
+    const bool code = block.kind == lira::DocBlock::Kind::Code;
+    const float inset = code ? CODE_PAD : 0.0f;
+    const float line_h = ImGui::GetTextLineHeight();
+    const float avail = std::max(wrap_w - inset * 2, 1.0f);
+    const char* text = block.text.data();
+
+    layout.runs.clear();
+    float x = 0.0f, y = 0.0f, max_x = 0.0f;
+    for (const auto& span : block.spans) {
+        const char* p = text + span.begin;
+        const char* e = text + span.end;
+        while (p < e) {
+            if (*p == '\n') { x = 0.0f; y += line_h; ++p; continue; }
+            // A word plus its trailing spaces (leading spaces form their own word)
+            const char* w = p;
+            while (w < e && *w != ' ' && *w != '\n') ++w;
+            while (w < e && *w == ' ') ++w;
+            const float ww = ImGui::CalcTextSize(p, w).x;
+            if (x > 0.0f && x + ww > avail) { x = 0.0f; y += line_h; }
+
+            const auto begin = static_cast<uint32_t>(p - text), end = static_cast<uint32_t>(w - text);
+            auto* last = layout.runs.empty() ? nullptr : &layout.runs.back();
+            if (last && last->style == span.style && last->end == begin && last->pos.y == y + inset) last->end = end;
+            else layout.runs.push_back({ImVec2(x + inset, y + inset), begin, end, span.style});
+            x += ww;
+            max_x = std::max(max_x, x);
+            p = w;
+        }
+    }
+    layout.size = ImVec2(max_x + inset * 2, y + line_h + inset * 2);
+    layout.width = wrap_w;
+    layout.version = block.version;
+}
+
+// Lays out dirty blocks and returns the size of the whole document
+ImVec2 LayoutMessage(MessageView& view, float wrap_w) {
+    const auto& blocks = view.doc.blocks();
+    view.layouts.resize(blocks.size());
+    ImVec2 size(0.0f, 0.0f);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        auto& layout = view.layouts[i];
+        if (layout.width != wrap_w || layout.version != blocks[i].version) LayoutBlock(blocks[i], layout, wrap_w);
+        size.x = std::max(size.x, blocks[i].kind == lira::DocBlock::Kind::Code ? wrap_w : layout.size.x);
+        size.y += layout.size.y + (i > 0 ? BLOCK_GAP : 0.0f);
+    }
+    return size;
+}
+
+ImU32 StyleColor(lira::TokenType style, ImU32 text) {
+    switch (style) {
+        case lira::TokenType::Bold:        return (text & 0x00FFFFFF) | (150u << IM_COL32_A_SHIFT); // *actions* are dimmed
+        case lira::TokenType::InlineCode:  return ImGui::ColorConvertFloat4ToU32(col_accent);
+        case lira::TokenType::CodeKeyword: return IM_COL32(198, 120, 221, 255);
+        case lira::TokenType::CodeString:  return IM_COL32(152, 195, 121, 255);
+        case lira::TokenType::CodeComment: return IM_COL32(128, 134, 145, 255);
+        case lira::TokenType::CodeNumber:  return IM_COL32(209, 154, 102, 255);
+        case lira::TokenType::CodeBlockContent: return IM_COL32(220, 223, 228, 255);
+        default: return text;
+    }
+}
+
+// Draws laid-out blocks at `origin`, skipping blocks outside the clip rect
+void DrawMessage(const MessageView& view, ImVec2 origin, float wrap_w, ImU32 text_col) {
+    ImDrawList* dl = ImGui::GetWindowDrawList();
+    const auto& blocks = view.doc.blocks();
+    float y = origin.y;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const auto& block = blocks[i];
+        const auto& layout = view.layouts[i];
+        const bool code = block.kind == lira::DocBlock::Kind::Code;
+        const ImVec2 bmin(origin.x, y);
+        const ImVec2 bmax(origin.x + (code ? wrap_w : layout.size.x), y + layout.size.y);
+        y += layout.size.y + BLOCK_GAP;
+        if (!ImGui::IsRectVisible(bmin, bmax)) continue;
+
+        if (code) dl->AddRectFilled(bmin, bmax, IM_COL32(40, 44, 52, 255), 6.0f);
+        for (const auto& run : layout.runs) {
+            dl->AddText(ImVec2(bmin.x + run.pos.x, bmin.y + run.pos.y), StyleColor(run.style, text_col),
+                        block.text.data() + run.begin, block.text.data() + run.end);
+        }
+    }
+}
+
 // --- Renderers ---
 
-void RenderMessageBubble(const lira::ChatMessage& msg, float width_avail) {
+// --- Bubble Geometry ---
+const float BUBBLE_PAD_X = 20.0f, BUBBLE_PAD_Y = 15.0f;
+const float BUBBLE_HEADER = 20.0f;   // "Lira" / "You" label
+const float BUBBLE_GAP = 28.0f;      // space below each bubble
+
+float BubbleTextWidth(float width_avail) { return (width_avail * 0.75f) - (BUBBLE_PAD_X * 2); }
+float BubbleHeight(float text_h) { return text_h + (BUBBLE_PAD_Y * 2) + BUBBLE_HEADER; }
+
+// Lays out the message unless its cached size is still valid
+ImVec2 MeasureMessage(MessageView& view, float max_w) {
+    view.ensure_parsed();
+    if (view.measured_width != max_w || view.measured_version != view.doc.version()) {
+        view.text_size = LayoutMessage(view, max_w);
+        view.measured_width = max_w;
+        view.measured_version = view.doc.version();
+    }
+    return view.text_size;
+}
+
+// Height from raw content (lines + wrapped length), without parsing
+float EstimateMessage(MessageView& view, float max_w) {
+    if (view.estimate_width != max_w) {
+        const std::string& c = view.msg->content;
+        const float chars_per_line = std::max(max_w / ImGui::CalcTextSize("x").x, 1.0f);
+        const float lines = std::count(c.begin(), c.end(), '\n') + 1 + c.size() / chars_per_line;
+        view.estimate = BubbleHeight(lines * ImGui::GetTextLineHeight());
+        view.estimate_width = max_w;
+    }
+    return view.estimate;
+}
+
+// Measured height when known for this width, otherwise the estimate
+float MessageHeight(MessageView& view, float max_w) {
+    const bool measured = view.measured_width == max_w && view.parsed && view.measured_version == view.doc.version();
+    return (measured ? BubbleHeight(view.text_size.y) : EstimateMessage(view, max_w)) + BUBBLE_GAP;
+}
+
+void RenderMessageBubble(MessageView& msg, float width_avail, ImVec2 start) {
     ImDrawList* dl = ImGui::GetWindowDrawList();
-    bool is_lira = (msg.role == "assistant"); // Lira is 'assistant' in JSON
-    float pad_x = 20.0f, pad_y = 15.0f;
-    float max_w = (width_avail * 0.75f) - (pad_x * 2);
+    bool is_lira = (msg.msg->role == "assistant"); // Lira is 'assistant' in JSON
+    float max_w = BubbleTextWidth(width_avail);
 
-    ImVec2 txt_sz = ImGui::CalcTextSize(msg.content.c_str(), nullptr, false, max_w);
-    ImVec2 bubble_sz(txt_sz.x + (pad_x * 2), txt_sz.y + (pad_y * 2) + 20.0f);
+    ImVec2 txt_sz = MeasureMessage(msg, max_w);
+    ImVec2 bubble_sz(txt_sz.x + (BUBBLE_PAD_X * 2), BubbleHeight(txt_sz.y));
 
     float shift_x = is_lira ? 0.0f : width_avail - bubble_sz.x;
-    ImVec2 start = ImGui::GetCursorScreenPos();
-    ImGui::Dummy(bubble_sz);
-
     ImVec2 box_min(start.x + shift_x, start.y);
     ImVec2 box_max(box_min.x + bubble_sz.x, box_min.y + bubble_sz.y);
 
     dl->AddRectFilled(ImVec2(box_min.x+5, box_min.y+5), ImVec2(box_max.x+5, box_max.y+5), col_shadow, 6.0f);
     dl->AddRectFilled(box_min, box_max, is_lira ? col_lira_bg : col_user_bg, 6.0f);
+    dl->AddText(ImVec2(box_min.x + BUBBLE_PAD_X, box_min.y + 10), is_lira ? IM_COL32(100,100,100,255) : IM_COL32(180,180,180,255),
+                is_lira ? (msg.thinking ? "Lira (thinking...)" : "Lira") : "You");
 
-    ImGui::SetCursorScreenPos(ImVec2(box_min.x + pad_x, box_min.y + 10));
-    ImGui::PushStyleColor(ImGuiCol_Text, is_lira ? IM_COL32(100,100,100,255) : IM_COL32(180,180,180,255));
-    ImGui::Text("%s", is_lira ? "Lira" : "You");
-    ImGui::PopStyleColor();
-
-    ImGui::SetCursorScreenPos(ImVec2(box_min.x + pad_x, box_min.y + 30));
-    ImGui::PushStyleColor(ImGuiCol_Text, is_lira ? col_lira_text : col_user_text);
-    ImGui::PushTextWrapPos(ImGui::GetCursorScreenPos().x + max_w + 1.0f);
-    ImGui::TextUnformatted(msg.content.c_str());
-    ImGui::PopTextWrapPos();
-    ImGui::PopStyleColor();
-
-    // Reset
-    ImGui::SetCursorScreenPos(ImVec2(start.x, start.y + bubble_sz.y));
-    ImGui::Dummy(ImVec2(0.0f, 20.0f));
+    DrawMessage(msg, ImVec2(box_min.x + BUBBLE_PAD_X, box_min.y + 30), max_w, is_lira ? col_lira_text : col_user_text);
+}
+
+// Virtualized transcript: message tops come from a prefix sum of cached (or
+// estimated) heights, and only bubbles intersecting the visible region are
+// parsed, laid out and drawn. Off-screen messages cost nothing per frame.
+void RenderTranscript(float width_avail) {
+    auto& t = app.active->transcript;
+    const float max_w = BubbleTextWidth(width_avail);
+    const size_t count = app.view_count();
+    if (t.dirty || t.width != max_w || t.offsets.size() != count + 1) {
+        t.offsets.resize(count + 1);
+        t.offsets[0] = 0.0f;
+        for (size_t i = 0; i < count; ++i) t.offsets[i + 1] = t.offsets[i] + MessageHeight(app.view_at(i), max_w);
+        t.width = max_w;
+        t.dirty = false;
+        t.tail_dirty = false;
+    } else if (t.tail_dirty) {
+        // Streaming only grows the live message, so the cost stays flat with session length
+        if (count > 0) t.offsets[count] = t.offsets[count - 1] + MessageHeight(app.view_at(count - 1), max_w);
+        t.tail_dirty = false;
+    }
+
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float view_top = ImGui::GetWindowPos().y - origin.y;
+    const float view_bottom = view_top + ImGui::GetWindowHeight();
+    size_t first = std::upper_bound(t.offsets.begin(), t.offsets.end(), view_top) - t.offsets.begin();
+    first = first > 0 ? first - 1 : 0;
+
+    for (size_t i = first; i < count && t.offsets[i] < view_bottom; ++i) {
+        auto& view = app.view_at(i);
+        RenderMessageBubble(view, width_avail, ImVec2(origin.x, origin.y + t.offsets[i]));
+        // Estimate replaced by the real height: shift everything below next frame
+        if (MessageHeight(view, max_w) != t.offsets[i + 1] - t.offsets[i]) (i + 1 == count ? t.tail_dirty : t.dirty) = true;
+    }
+
+    ImGui::SetCursorScreenPos(origin);
+    ImGui::Dummy(ImVec2(width_avail, t.offsets.back()));
 }
 
 void RenderSettingsPopup(float width) {
     if (!app.settings_open) return;
     ImVec2 center = ImGui::GetMainViewport()->GetCenter();
     ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
-    ImGui::SetNextWindowSize(ImVec2(400, 320));
+    ImGui::SetNextWindowSize(ImVec2(400, 355));
 
     ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(col_sidebar.x+0.05f, col_sidebar.y+0.05f, col_sidebar.z+0.05f, 1.0f));
     ImGui::PushStyleColor(ImGuiCol_Border, col_accent);
@@ -166,6 +624,10 @@ void RenderSettingsPopup(float width) {
         ImGui::TextDisabled("API Key");
         ImGui::InputText("##Key", app.apiKey, 512, ImGuiInputTextFlags_Password);
         ImGui::PopItemWidth();
+        ImGui::Dummy(ImVec2(0, 5));
+        ImGui::Checkbox("Show frame time", &app.show_frame_stats);
+        ImGui::SameLine();
+        ImGui::Checkbox("Low-power redraw", &app.event_driven);
 
         ImGui::Dummy(ImVec2(0, 20));
         if (ImGui::Button("Close", ImVec2(360, 35))) app.settings_open = false;
@@ -215,6 +677,39 @@ void RenderNewSessionPopup() {
     ImGui::PopStyleColor(2);
 }
 
+void RenderApprovalModal() {
+    std::string cmd;
+    {
+        std::lock_guard lock(app.approval_mtx);
+        if (!app.approval_reply) return;
+        cmd = app.approval_cmd;
+    }
+    ImGui::SetNextWindowPos(ImGui::GetMainViewport()->GetCenter(), ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(520, 0));
+
+    ImGui::PushStyleColor(ImGuiCol_WindowBg, col_sidebar);
+    ImGui::PushStyleColor(ImGuiCol_Border, col_accent);
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 10.0f);
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowBorderSize, 1.0f);
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(20,20));
+
+    ImGui::OpenPopup("Run Command");
+    if (ImGui::BeginPopupModal("Run Command", nullptr, ImGuiWindowFlags_NoDecoration)) {
+        ImGui::TextColored(col_accent, "Lira wants to run:");
+        ImGui::Dummy(ImVec2(0, 5));
+        ImGui::PushTextWrapPos(0.0f);
+        ImGui::TextUnformatted(cmd.c_str());
+        ImGui::PopTextWrapPos();
+        ImGui::Dummy(ImVec2(0, 15));
+        if (ImGui::Button("Allow", ImVec2(235, 35))) { app.answer_approval(true); ImGui::CloseCurrentPopup(); }
+        ImGui::SameLine();
+        if (ImGui::Button("Deny", ImVec2(235, 35))) { app.answer_approval(false); ImGui::CloseCurrentPopup(); }
+        ImGui::EndPopup();
+    }
+    ImGui::PopStyleVar(3);
+    ImGui::PopStyleColor(2);
+}
+
 void RenderSidebarItem(const std::string& label, bool selected) {
     ImVec2 p = ImGui::GetCursorScreenPos();
     float width = ImGui::GetContentRegionAvail().x;
@@ -269,12 +764,31 @@ int main(int, char**) {
     SetTheme(1); // Set default theme
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
+    app.start();
 
     char input_buffer[4096] = "";
 
+    // Redraw while the window is being resized (the loop is blocked then on some platforms)
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { app.redraw_frames = SETTLE_FRAMES; });
+
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+        if (app.event_driven && app.redraw_frames <= 0) {
+            const double timeout = io.WantTextInput ? CURSOR_BLINK_TIMEOUT : IDLE_TIMEOUT;
+            const double slept_from = glfwGetTime();
+            glfwWaitEventsTimeout(timeout);
+            // A plain timeout (caret blink, periodic refresh) needs just one frame
+            app.redraw_frames = (glfwGetTime() - slept_from >= timeout) ? 1 : SETTLE_FRAMES;
+        } else {
+            glfwPollEvents();
+        }
+        app.wake_posted.store(false);
+        --app.redraw_frames;
+        ++app.frames_rendered;
+        app.cpu.sample(glfwGetTime());
+        const auto frame_start = std::chrono::steady_clock::now();
         ImGui_ImplOpenGL3_NewFrame(); ImGui_ImplGlfw_NewFrame(); ImGui::NewFrame();
+        // Drags and held buttons keep drawing until released
+        if (ImGui::IsAnyItemActive() || ImGui::IsMouseDown(0)) app.redraw_frames = std::max(app.redraw_frames, 1);
 
         ImGui::SetNextWindowPos(ImVec2(0,0)); ImGui::SetNextWindowSize(io.DisplaySize);
         ImGui::Begin("Root", nullptr, ImGuiWindowFlags_NoDecoration|ImGuiWindowFlags_NoResize|ImGuiWindowFlags_NoMove|ImGuiWindowFlags_NoScrollbar|ImGuiWindowFlags_NoScrollWithMouse);
@@ -303,7 +817,7 @@ int main(int, char**) {
 
             // Render Session List
             for (const auto& session : app.session_list) {
-                bool is_active = (session == app.active_agent->current_session_name);
+                bool is_active = (session == app.active->name);
                 RenderSidebarItem(session, is_active);
             }
             ImGui::PopItemWidth();
@@ -334,6 +848,7 @@ int main(int, char**) {
         // Render Popups (Z-Order Top)
         RenderSettingsPopup(sidebar_w);
         RenderNewSessionPopup();
+        RenderApprovalModal();
 
         ImGui::SameLine();
 
@@ -348,13 +863,17 @@ int main(int, char**) {
             ImGui::Indent(50);
 
             // Get History from Agent
-            auto history = app.active_agent->get_display_history();
-            if (history.empty()) {
+            app.poll_sessions();
+            app.pump_tokens();
+            app.sync_views();
+            if (app.active->is_loading()) {
+                ImGui::TextDisabled("Loading session...");
+            } else if (app.active->failed) {
+                ImGui::TextDisabled("Could not load this session.");
+            } else if (app.view_count() == 0) {
                 ImGui::TextDisabled("New conversation started. Say hello!");
             }
-            for (const auto& msg : history) {
-                RenderMessageBubble(msg, chat_w - 100);
-            }
+            RenderTranscript(chat_w - 100);
 
             ImGui::Unindent(50);
             if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY()) ImGui::SetScrollHereY(1.0f);
@@ -376,17 +895,11 @@ int main(int, char**) {
             ImGui::PopFont(); ImGui::PopStyleVar(2); ImGui::PopStyleColor();
             ImGui::SameLine();
             ImGui::PushFont(font_input);
-            if (ImGui::Button(" > ", ImVec2(btn_w, bar_h)) || enter) {
-                if (strlen(input_buffer) > 0) {
-                    // Update Agent History (Simulated processing for now)
+            if (ImGui::Button(app.busy ? " ... " : " > ", ImVec2(btn_w, bar_h)) || enter) {
+                if (strlen(input_buffer) > 0 && !app.busy) {
+                    // Runs Agent::process on the worker; the prompt shows immediately as a live view
                     std::string prompt = input_buffer;
-
-                    // We manually inject the user message into the agent's history so it appears immediately
-                    // Note: In next step (threading), we will call app.active_agent->process(prompt) in a thread.
-                    // For now, we update history so the UI refreshes.
-
-                    // Hack: Access underlying json history to push user message for display
-                    app.active_agent->history.push_back({{"role", "user"}, {"content", prompt}});
+                    app.send(prompt);
 
                     // Clear input
                     input_buffer[0] = '\0';
@@ -399,13 +912,27 @@ int main(int, char**) {
         ImGui::EndGroup();
         ImGui::End();
 
+        if (app.show_frame_stats) {
+            char stats[160];
+            snprintf(stats, sizeof(stats), "frame %.2f ms avg / %.2f ms max  |  %zu msgs  |  %llu frames  |  cpu %.1f%% (idle target %.0f%%)",
+                     app.frame_stats.avg(), app.frame_stats.max(), app.active->views.size(),
+                     static_cast<unsigned long long>(app.frames_rendered), app.cpu.percent, IDLE_CPU_TARGET);
+            const ImVec2 sz = ImGui::CalcTextSize(stats);
+            const ImVec2 pos(io.DisplaySize.x - sz.x - 12.0f, 8.0f);
+            ImDrawList* fg = ImGui::GetForegroundDrawList();
+            fg->AddRectFilled(ImVec2(pos.x - 6, pos.y - 3), ImVec2(pos.x + sz.x + 6, pos.y + sz.y + 3), IM_COL32(0, 0, 0, 160), 4.0f);
+            fg->AddText(pos, IM_COL32(120, 255, 140, 255), stats);
+        }
+
         ImGui::Render();
         int w, h; glfwGetFramebufferSize(window, &w, &h); glViewport(0,0,w,h);
         glClearColor(col_bg.x, col_bg.y, col_bg.z, col_bg.w); glClear(GL_COLOR_BUFFER_BIT);
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        app.frame_stats.add(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frame_start).count());
         glfwSwapBuffers(window);
     }
 
+    app.shutdown();
     ImGui_ImplOpenGL3_Shutdown(); ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext(); glfwDestroyWindow(window); glfwTerminate();
     return 0;
@@ -9,17 +9,53 @@
 #include <unistd.h>
 #include "Agent.h"
 #include "Helpers.h"
+#include "Metrics.h"
+#include "SearchCache.h"
 
 int main(int argc, char* argv[]) {
     std::string session = "main";
     std::string one_shot_input;
+    bool nexus_compact = false;
+    bool search_stats = false;
+    bool stats = false;
+    bool stats_json = false;
 
     // Parse Flags
     for (int i = 1; i < argc; ++i) {
         if (std::string arg = argv[i]; arg == "-s" || arg == "--session") { if (i + 1 < argc) session = argv[++i]; }
+        else if (arg == "--nexus-compact") nexus_compact = true;
+        else if (arg == "--search-stats") search_stats = true;
+        else if (arg == "--stats") stats = true;
+        else if (arg == "--stats-json") stats_json = true;
         else one_shot_input += arg + " ";
     }
 
+    // Offline Nexus maintenance (no API key needed)
+    if (nexus_compact) {
+        lira::Nexus nexus;
+        size_t removed = nexus.compact();
+        std::cout << lira::ANSI_CYAN << "[Nexus] Removed " << removed << " near-duplicate memories, "
+                  << nexus.size() << " remain." << lira::ANSI_RESET << std::endl;
+        return 0;
+    }
+
+    if (search_stats) {
+        const auto s = lira::SearchCache::shared()->stats();
+        std::cout << lira::ANSI_CYAN << "[Search cache] " << s.hits << " hits, " << s.stale_hits << " stale hits, "
+                  << s.misses << " misses (" << static_cast<int>(s.hit_rate() * 100 + 0.5) << "% hit rate), "
+                  << s.stores << " stored, " << s.evictions << " evicted, " << s.revalidations << " refreshed."
+                  << lira::ANSI_RESET << std::endl;
+        return 0;
+    }
+
+    // Usage metrics of every model so far, as a table or JSON for dashboards
+    if (stats || stats_json) {
+        const auto m = lira::Metrics::shared()->stats();
+        if (stats_json) std::cout << lira::Metrics::to_json(m).dump(2) << std::endl;
+        else std::cout << lira::Metrics::format(m);
+        return 0;
+    }
+
     // Handle Pipe
     if (!isatty(STDIN_FILENO)) {
         std::string line;
@@ -30,7 +66,10 @@ int main(int argc, char* argv[]) {
 
     // One-Shot Mode
     if (!one_shot_input.empty()) {
+        agent.more_turns = false;
         agent.process(one_shot_input);
+        // A stale search result served this turn may still be refreshing
+        lira::SearchCache::shared()->wait_revalidations();
         return 0;
     }
 
@@ -44,6 +83,7 @@ int main(int argc, char* argv[]) {
         if (line.empty()) continue;
         agent.process(line);
     }
+    lira::SearchCache::shared()->wait_revalidations();
     return 0;
 }
 